@@ -1,16 +1,27 @@
+# Only the modules used from C++ are linked on desktop: every linked library is loaded at startup.
+# The QML modules a pushed project may import (3D, Multimedia, Location, ...) are plugins
+# loaded from the Qt installation on first import.
 QT += \
     core gui qml quick \
     quickcontrols2 \
-    widgets \
-    multimedia sql \
     network websockets \
-    xml xmlpatterns svg \
-    sensors bluetooth nfc \
-    positioning location \
-    3dcore 3drender 3dinput 3dquick \
+    concurrent \
+    svg \
     webview
 #    charts \
 
+# Mobile packages only contain the linked modules (with their Java parts on Android):
+# the modules imported by Modules.qml stay linked there, or projects using them would not load.
+android|ios {
+    QT += \
+        widgets \
+        multimedia sql \
+        xml xmlpatterns \
+        sensors bluetooth nfc \
+        positioning location \
+        3dcore 3drender 3dinput 3dquick
+}
+
 # For ZipReader & ZipWriter
 QT += gui-private
 
@@ -34,10 +45,28 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    assetbundle.cpp \
+    assetimporter.cpp \
+    asyncfileio.cpp \
+    blobstore.cpp \
+    componentwarmer.cpp \
     filesystem.cpp \
+    filewriter.cpp \
+    frameprofiler.cpp \
+    fstreesnapshot.cpp \
+    latencytracer.cpp \
+    logging.cpp \
+    memoryfilestore.cpp \
         main.cpp \
     applicationcontrol.cpp \
-    multicastlock.cpp
+    multicastlock.cpp \
+    projectcache.cpp \
+    reloadscheduler.cpp \
+    renderworker.cpp \
+    sessionrecorder.cpp \
+    startuptrace.cpp \
+    syncsession.cpp \
+    syncworker.cpp
 
 RESOURCES += qml.qrc
 
@@ -54,9 +83,27 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 HEADERS += \
     applicationcontrol.h \
+    assetbundle.h \
+    assetimporter.h \
+    asyncfileio.h \
+    blobstore.h \
+    componentwarmer.h \
     filesystem.h \
+    filewriter.h \
+    frameprofiler.h \
+    fstreesnapshot.h \
+    latencytracer.h \
+    logging.h \
     macros.h \
-    multicastlock.h
+    memoryfilestore.h \
+    multicastlock.h \
+    projectcache.h \
+    reloadscheduler.h \
+    renderworker.h \
+    sessionrecorder.h \
+    startuptrace.h \
+    syncsession.h \
+    syncworker.h
 RC_FILE = img/appicon.rc
 
 DISTFILES += \
@@ -6,39 +6,35 @@
 #include <QProcess>
 #include <QStandardPaths>
 #include <QDataStream>
-#include <private/qzipreader_p.h>
-#include <private/qzipwriter_p.h>
 #include <QHostInfo>
 #include <QNetworkDatagram>
 #include <QTimer>
 #include <QUdpSocket>
+#include <QQuickWindow>
+#include <QSettings>
+#include <QtWebView>
 
-inline QString quoted(const QString& pToQuote) { return "\"" + pToQuote + "\""; }
+#include "filesystem.h"
+#include "logging.h"
 
-inline QString beginTag(const QString& tag)
+namespace
 {
-    return "<" + tag + ">";
+const int kReplayDrainInterval = 50;    // ms
+const int kReplayDrainTimeout = 30000;  // ms, for traces that never reach the screen (load errors...)
 }
 
-inline QString endTag(const QString& tag)
+inline QString quoted(const QString& pToQuote) { return "\"" + pToQuote + "\""; }
+
+inline QString megabytes(qint64 pBytes)
 {
-    return "</" + tag + ">";
+    return pBytes < 0 ? QString("n/a") : QString::number(pBytes / (1024.0 * 1024.0), 'f', 2) + "MB";
 }
 
 QString ApplicationControl::messageContent(const QString& message,
                                            const QString& tag,
                                            int fromIndex)
 {
-    QString bTag = beginTag(tag);
-    QString eTag = endTag(tag);
-
-    int beginIndex = message.indexOf(bTag, fromIndex);
-    int endIndex = message.indexOf(eTag, fromIndex);
-
-    if (endIndex <= beginIndex)
-        return QString(); // null qstring
-
-    return message.mid(beginIndex + bTag.length(), endIndex - beginIndex - bTag.length());
+    return SyncWorker::messageContent(message, tag, fromIndex);
 }
 
 QStringList ApplicationControl::availableAddresses() const
@@ -51,13 +47,15 @@ QString ApplicationControl::idFromIp(const QString &pIp)
     return mServers[pIp];
 }
 
-ApplicationControl::ApplicationControl(QObject *parent)
+ApplicationControl::ApplicationControl(const QString &pWritePath, QObject *parent)
     : QObject(parent),
       m_currentFile(""),
       groupAddress4(QStringLiteral("239.255.255.250")),
-      groupAddress6(QStringLiteral("ff12::2115"))
+      groupAddress6(QStringLiteral("ff12::2115")),
+      mNetworkAccessManagerFactory(&mMemoryStore)
 {
-    mWritePath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/qmlplaygroundclient_cache";
+    mWritePath = !pWritePath.isEmpty() ? pWritePath :
+                                         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/qmlplaygroundclient_cache";
     setProjectsPath(mWritePath + "/projects/");
 
     setStatus("");
@@ -68,8 +66,15 @@ ApplicationControl::ApplicationControl(QObject *parent)
     socket->setParent(this);
     connect(this, &ApplicationControl::activeServerIpChanged, [=]()
     {
+        // A replayed session runs without socket
+        if (mReplaying)
+            return;
         socket->open(QUrl(QString("ws://%1").arg(m_activeServerIp)));
     });
+    connect(socket, &QWebSocket::connected, this, [=]()
+    {
+        socket->sendTextMessage(SyncWorker::capabilitiesMessage());
+    });
     connect(socket, &QWebSocket::textMessageReceived, this, &ApplicationControl::onTextMessageReceived);
     connect(socket, &QWebSocket::binaryMessageReceived, this, &ApplicationControl::onBinaryMessageReceived);
 
@@ -87,17 +92,90 @@ ApplicationControl::ApplicationControl(QObject *parent)
     connect(&udpSocket4, SIGNAL(readyRead()), this, SLOT(processPendingDatagrams()));
     connect(&udpSocket6, &QUdpSocket::readyRead, this, &ApplicationControl::processPendingDatagrams);
 
-    // Asset import
-    connect(&mAssetImporter, &QThread::finished, this, &ApplicationControl::handleAssetImportResults);
+    // Sync thread: message parsing, file writes and asset import
+    mSyncWorker = new SyncWorker();
+    mSyncWorker->setWritePath(mWritePath);
+    mSyncWorker->setProjectsPath(projectsPath());
+    mSyncWorker->setProjectsBudget(QSettings().value("cache/projectsBudget", 512 * 1024 * 1024).toLongLong());
+    mSyncWorker->setLatencyTracer(&mLatencyTracer);
+
+    // Documents are loaded from the text files in memory rather than from the disk (see setEngine)
+    mServeFromMemory = QSettings().value("sync/serveFromMemory", true).toBool();
+    if (mServeFromMemory)
+        mSyncWorker->setMemoryStore(&mMemoryStore);
+
+    // Last project of the previous launch, if still in the cache
+    QSettings lastProject;
+    lastProject.beginGroup("lastProject");
+    QString lastFile = lastProject.value("file").toString();
+    if (!lastFile.isEmpty() && QFileInfo::exists(QString(lastFile).replace("file:///", "")))
+    {
+        mRestoredFile = lastFile;
+        setCurrentFolder(lastProject.value("folder").toString());
+        setCurrentProjectPath(lastProject.value("projectPath").toString());
+        mSyncWorker->setCurrentProject(m_currentFolder, m_currentProjectPath);
+    }
+    lastProject.endGroup();
+    mSyncWorker->moveToThread(&mSyncThread);
+    connect(&mSyncThread, &QThread::finished, mSyncWorker, &QObject::deleteLater);
+
+    connect(mSyncWorker, &SyncWorker::projectReady, this, &ApplicationControl::handleProjectReady);
+    connect(mSyncWorker, &SyncWorker::currentFileReady, this, &ApplicationControl::handleCurrentFileReady);
+    connect(mSyncWorker, &SyncWorker::jsonMessageReady, this, &ApplicationControl::jsonMessage);
+    connect(mSyncWorker, &SyncWorker::assetImportFinished, this, &ApplicationControl::handleAssetImportResults);
+    connect(mSyncWorker, &SyncWorker::writeStatsChanged, this, &ApplicationControl::handleWriteStatsChanged);
+    connect(mSyncWorker, &SyncWorker::webViewRequired, this, &ApplicationControl::handleWebViewRequired);
+    connect(mSyncWorker, &SyncWorker::cachedProjectsChanged, this, &ApplicationControl::setCachedProjects);
+    connect(mSyncWorker, &SyncWorker::resyncRequired, this, &ApplicationControl::requestResync);
+
+    mSyncThread.setObjectName("SyncThread");
+    mSyncThread.start();
+    QMetaObject::invokeMethod(mSyncWorker, "refreshCachedProjects", Qt::QueuedConnection);
+
+    connect(&mReloadScheduler, &ReloadScheduler::reloadRequested, this, [=](const QString& pSource)
+    {
+        emit reloadRequested(documentUrl(pSource).toString());
+    });
+
+    // Memory accounting
+    QSettings settings;
+    mMemoryBudgets.pendingMessages = settings.value("memory/pendingMessagesBudget", 32 * 1024 * 1024).toLongLong();
+    mMemoryBudgets.process = settings.value("memory/processBudget", 0).toLongLong();
+    mMemoryTimer.setInterval(settings.value("memory/logInterval", 10000).toInt());
+    connect(&mMemoryTimer, &QTimer::timeout, this, &ApplicationControl::updateMemoryUsage);
+    mMemoryTimer.start();
+
+    // Frame timings, shown in an overlay and sent to the server
+    setFrameProfilerEnabled(false);
+    mFrameProfiler.setPeriod(settings.value("telemetry/interval", 2000).toInt());
+    connect(this, &ApplicationControl::frameProfilerEnabledChanged, &mFrameProfiler, &FrameProfiler::setEnabled);
+    connect(&mFrameProfiler, &FrameProfiler::periodFinished, this, &ApplicationControl::sendTelemetry);
+
+    // Session replay
+    connect(&mSessionPlayer, &SessionPlayer::textMessage, this, &ApplicationControl::onTextMessageReceived);
+    connect(&mSessionPlayer, &SessionPlayer::binaryMessage, this, &ApplicationControl::onBinaryMessageReceived);
+    // The last frames are only posted to the sync worker: over once they are processed and displayed
+    mReplayDrainTimer.setInterval(kReplayDrainInterval);
+    connect(&mReplayDrainTimer, &QTimer::timeout, this, &ApplicationControl::finishReplay);
+    connect(&mSessionPlayer, &SessionPlayer::finished, this, [=]()
+    {
+        mReplayDrainClock.start();
+        mReplayDrainTimer.start();
+    });
 }
 
 ApplicationControl::~ApplicationControl()
 {
+    mSessionRecorder.stop();
+    qDeleteAll(mSessions);
+
+    mSyncThread.quit();
+    mSyncThread.wait();
 }
 
 bool ApplicationControl::createFolder(QString pPath, QString pFolderName)
 {
-    QString lPath = pPath.replace("file:///", "");
+    QString lPath = MemoryFileStore::localFilePath(pPath);
     QString lFilePath = lPath + "/" + pFolderName;
 
     QDir dir(lPath);
@@ -111,31 +189,14 @@ bool ApplicationControl::createFolder(QString pPath, QString pFolderName)
 
 bool ApplicationControl::createFile(QString pPath, QString pFileName, QString pFileContent)
 {
-    QString lPath = pPath.replace("file:///", "");
-    lPath += "/" + pFileName;
-
-    // Ensure target directory exists
-    QString targetDir = lPath.mid(0, lPath.lastIndexOf("/"));
-    QDir().mkpath(targetDir);
-
-    QFile file(lPath);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QTextStream textStream(&file);
-        textStream << pFileContent;
-    }
-    else
-    {
-        qDebug() << QString("Unable to create file \"%1\"").arg(lPath);
-        return false;
-    }
-    return true;
+    QString lPath = MemoryFileStore::localFilePath(pPath);
+    invalidateCachedProject(lPath);
+    return SyncWorker::createFile(lPath, pFileName, pFileContent);
 }
 
 QString ApplicationControl::readFileContents(const QString &pFilePath)
 {
-    QString filePath = pFilePath;
-    filePath = filePath.replace("file:///", "");
+    QString filePath = MemoryFileStore::localFilePath(pFilePath);
 
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly))
@@ -147,8 +208,10 @@ QString ApplicationControl::readFileContents(const QString &pFilePath)
 
 bool ApplicationControl::writeFileContents(const QString &pFilePath, const QString &pFileContents)
 {
-    QString filePath = pFilePath;
-    filePath = filePath.replace("file:///", "");
+    QString filePath = MemoryFileStore::localFilePath(pFilePath);
+
+    invalidateCachedProject(filePath);
+    BlobStore::breakLink(filePath);
 
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly))
@@ -162,8 +225,7 @@ bool ApplicationControl::writeFileContents(const QString &pFilePath, const QStri
 
 bool ApplicationControl::deleteFileSystemEntry(const QString &pFilePath)
 {
-    QString filePath = pFilePath;
-    filePath = filePath.replace("file:///", "");
+    QString filePath = MemoryFileStore::localFilePath(pFilePath);
 
     QFileInfo info(filePath);
     if (!info.exists())
@@ -172,6 +234,8 @@ bool ApplicationControl::deleteFileSystemEntry(const QString &pFilePath)
         return false;
     }
 
+    invalidateCachedProject(filePath);
+
     if (info.isDir())
     {
         QDir dir(filePath);
@@ -183,13 +247,9 @@ bool ApplicationControl::deleteFileSystemEntry(const QString &pFilePath)
     }
     else
     {
+        // Unlinking only needs the directory to be writable: files linked to the blob store
+        // are read-only, and changing their permissions would change the shared blob
         QFile file(filePath);
-        if (!file.setPermissions(QFile::WriteOther))
-        {
-            setDeleteFileSystemEntryError("Could not get permissions.");
-            return false;
-        }
-
         if (!file.remove())
         {
             setDeleteFileSystemEntryError(file.errorString());
@@ -201,259 +261,183 @@ bool ApplicationControl::deleteFileSystemEntry(const QString &pFilePath)
     return true;
 }
 
-void ApplicationControl::addContextProperty(const QString& pKey, QVariant pData)
+void ApplicationControl::readFileContentsAsync(const QString &pFilePath, const QJSValue &pCallback)
 {
-    mEngine->rootContext()->setContextProperty(pKey, pData);
+    mFileIo.read(pFilePath, pCallback);
 }
 
-void ApplicationControl::onTextMessageReceived(const QString &pMessage)
+void ApplicationControl::readFileRangeAsync(const QString &pFilePath, qint64 pOffset, qint64 pLength, const QJSValue &pCallback)
 {
-    if (this->isProcessing())
-    {
-        mTextMessageQueue.enqueue(pMessage);
-        return;
-    }
-
-    // Handle message type
-    QString messageType = messageContent(pMessage, "messagetype");
-
-    if (messageType == "folderchange")
-    {
-//        mEngine->trimComponentCache();
-//        mEngine->clearComponentCache();
-        handleFolderChangeMessage(pMessage);
-    }
-    else if (messageType == "filechange")
-    {
-//        mEngine->trimComponentCache();
-//        mEngine->clearComponentCache();
-        handleFileChangeMessage(pMessage);
-    }
-    else if (messageType == "data")
-    {
-        // hand the data message over to the qml
-        QString json = messageContent(pMessage, "json");
-        emit this->jsonMessage(json);
-    }
+    mFileIo.readRange(pFilePath, pOffset, pLength, pCallback);
 }
 
-bool customExtractAll(QZipReader& zipReader, QString destinationDir)
+void ApplicationControl::readFileChunksAsync(const QString &pFilePath, int pChunkSize, const QJSValue &pCallback)
 {
-    using FileInfo = QZipReader::FileInfo;
-    QDir baseDir(destinationDir);
-
-    // create directories first
-    QVector<FileInfo> allFiles = zipReader.fileInfoList();
-    foreach (FileInfo fi, allFiles)
-    {
-        const QString absPath = destinationDir + "/" + fi.filePath;
-        if (fi.isDir)
-        {
-            if (!baseDir.mkpath(fi.filePath))
-            {
-                qDebug() << "could not create " << fi.filePath << "in" << baseDir.path();
-//                return false;
-                continue;
-            }
-            if (!QFile::setPermissions(absPath, fi.permissions))
-            {
-                qDebug() << "could not set Permissions to" << absPath << "permissions:" << fi.permissions;
-//                return false;
-                continue;
-            }
-        }
-    }
-
-    // set up symlinks
-    foreach (FileInfo fi, allFiles)
-    {
-        const QString absPath = destinationDir + "/" + fi.filePath;
-        if (fi.isSymLink)
-        {
-            QString destination = QFile::decodeName(zipReader.fileData(fi.filePath));
-            if (destination.isEmpty())
-            {
-                qDebug() << absPath << "destination is empty";
-//                return false;
-                continue;
-            }
+    mFileIo.readChunks(pFilePath, pChunkSize, pCallback);
+}
 
-            QFileInfo linkFi(absPath);
-            if (!QFile::exists(linkFi.absolutePath()))
-                QDir::root().mkpath(linkFi.absolutePath());
-            if (!QFile::link(destination, absPath))
-            {
-                qDebug() << "Could not link" << destination << "to" << absPath;
-//                return false;
-                continue;
-            }
-            /* cannot change permission of links
-                 if (!QFile::setPermissions(absPath, fi.permissions))
-                     return false;
-                 */
-        }
-    }
+void ApplicationControl::writeFileContentsAsync(const QString &pFilePath, const QString &pFileContents, const QJSValue &pCallback)
+{
+    invalidateCachedProject(AsyncFileIo::localPath(pFilePath));
+    mFileIo.write(pFilePath, pFileContents, pCallback);
+}
 
-    foreach (FileInfo fi, allFiles)
-    {
-        const QString absPath = destinationDir + "/" + fi.filePath;
-        if (fi.isFile)
-        {
-            QFileInfo qfi(absPath);
-            if (!QDir().exists(qfi.absolutePath()))
-                QDir().mkpath(qfi.absolutePath());
+void ApplicationControl::addContextProperty(const QString& pKey, QVariant pData)
+{
+    mEngine->rootContext()->setContextProperty(pKey, pData);
+}
 
-            QFile f(absPath);
-            if (!f.open(QIODevice::WriteOnly))
-            {
-                qDebug() << "Could not open " << absPath << "[WriteOnly]";
-//                return false;
-                continue;
-            }
-            f.write(zipReader.fileData(fi.filePath));
-            f.setPermissions(fi.permissions);
-            f.close();
-        }
-    }
+void ApplicationControl::onTextMessageReceived(const QString &pMessage)
+{
+    if (!mReplaying)
+        mSessionRecorder.recordTextMessage(pMessage);
 
-    return true;
+    // Parsing and writes happen on the sync thread, after any import in progress
+    mSyncWorker->postTextMessage(pMessage, mLatencyTracer.beginTrace());
 }
 
-void AssetImporter::run()
+void ApplicationControl::onBinaryMessageReceived(const QByteArray &pMessage)
 {
-    mutex.lock();
-
-    errorString.clear();
-    QString result;
+    if (!mReplaying)
+        mSessionRecorder.recordBinaryMessage(pMessage);
 
-    // Prepare a stream to get fields from the message
-    QByteArray message = messageToProcess;
-    QDataStream stream(&message, QIODevice::ReadOnly);
+    // Queued on the sync thread with the text messages: imports run in arrival order
+    mPendingImports++;
+    setStatus("Loading assets...");
+    setIsProcessing(true);
 
-    // Prepare fields that will be read
-    QString readProjectName;
-    QByteArray payload;
-    qint32 payloadSize;
-    stream >> readProjectName
-           >> payloadSize
-           >> folderChangeMessage;
+    mSyncWorker->postBinaryMessage(pMessage, mLatencyTracer.beginTrace());
+}
 
-    // Read the payload (zip file)
-    payload.resize(payloadSize);
-    stream.readRawData(payload.data(), payloadSize);
-//    qDebug() << "read project name: " << readProjectName
-//             << "read payload size: " << payloadSize
-//             << "read folderchangemessage: " << folderChangeMessage;
+void ApplicationControl::requestResync(const QString &pRemoteFile)
+{
+    // A replayed session has no server to ask: the file stays at its last content
+    if (mReplaying || socket->state() != QAbstractSocket::ConnectedState)
+        return;
 
-//    QString filePath = "C:/Users/vincent.ponchaut/Desktop/perso/testzipresult_client/zaza.zip";
-    QString zipFilePath = mWritePath + QString("/projects/%1/%1.zip").arg(readProjectName);
-    QFileInfo fileInfo(zipFilePath);
-    projectDir = fileInfo.absolutePath();
+    socket->sendTextMessage(SyncWorker::resyncMessage(pRemoteFile));
+}
 
-    // Ensure resulting directory exists
-    if (!QDir().mkpath(projectDir))
-    {
-        errorString = "Error creating " + projectDir;
-        return;
-    }
+QString ApplicationControl::recentLog() const
+{
+    return LogRingBuffer::instance().entries().join("\n");
+}
 
-    if (QDir().exists(projectDir) && !deleteDirectory(projectDir))
-    {
-        qDebug() << "Could not cleanup " + projectDir;
-    }
+bool ApplicationControl::dumpLog(QString pFilePath)
+{
+    if (pFilePath.isEmpty())
+        pFilePath = mWritePath + "/log.txt";
 
-    // Remove previous file if it exists
-    if (fileInfo.exists() && !QFile::remove(zipFilePath))
+    QFile file(pFilePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
     {
-        errorString = "Error removing " + zipFilePath;
-        qDebug() << errorString;
-        return;
+        qWarning() << "Could not write the log to" << pFilePath;
+        return false;
     }
+    file.write(recentLog().toUtf8());
+    qInfo() << "Log written to" << pFilePath;
+    return true;
+}
 
-    // Create the resulting file
-    QFile file(zipFilePath);
-    if (!file.open(QIODevice::ReadWrite))
-    {
-        errorString = "Error: could not open " + zipFilePath;
-        qDebug() << errorString;
-        return;
-    }
+bool ApplicationControl::sendLog()
+{
+    if (socket->state() != QAbstractSocket::ConnectedState)
+        return false;
 
-    // write to it
-    file.write(payload);
-    file.close(); // Important: close before attempting a read
+    socket->sendTextMessage("<messagetype>log</messagetype><content>" + recentLog() + "</content>");
+    return true;
+}
 
-    // Now uncompress the data
-    QZipReader zipReader(zipFilePath);
-    if (zipReader.status() != QZipReader::NoError)
-    {
-        QString s = zipReader.status() == QZipReader::NoError ? "NoError" :
-                    zipReader.status() == QZipReader::FileReadError ? "FileReadError" :
-                    zipReader.status() == QZipReader::FileOpenError ? "FileOpenError" :
-                    zipReader.status() == QZipReader::FilePermissionsError ? "FilePermissionsError" :
-                                                                             "FileError";
-        qDebug() << s;
-        return;
-    }
+bool ApplicationControl::startRecording(const QString &pFilePath)
+{
+    return mSessionRecorder.start(pFilePath);
+}
 
-//    while (!zipReader.extractAll(projectDir))
-    while (!customExtractAll(zipReader, projectDir))
-    {
-        errorString = "Error: could not extract " + zipFilePath;
-        qDebug() << errorString;
+void ApplicationControl::stopRecording()
+{
+    mSessionRecorder.stop();
+}
 
-        sleep(1);
-//        return;
-    }
+bool ApplicationControl::replaySession(const QString &pFilePath, double pSpeed)
+{
+    if (!mSessionPlayer.load(pFilePath))
+        return false;
 
-    // Remove the zip file
-    if (!file.remove())
-    {
-        qDebug() << "Could not remove " << file.fileName();
-    }
+    // Replayed frames replace the server
+    mReplaying = true;
+    socket->close();
 
-    mutex.unlock();
+    qDebug() << "Replaying" << mSessionPlayer.frameCount() << "frames from" << pFilePath
+             << "at" << (pSpeed <= 0.0 ? QString("max speed") : QString("%1x").arg(pSpeed));
+    mSessionPlayer.play(pSpeed);
+    return true;
 }
 
-bool AssetImporter::deleteDirectory(const QString &pDirectory)
+void ApplicationControl::finishReplay()
 {
-    bool success = true;
+    const bool drained = mSyncWorker->isIdle() && mPendingImports == 0 && mLatencyTracer.openTraceCount() == 0;
+    if (!drained && mReplayDrainClock.elapsed() < kReplayDrainTimeout)
+        return;
 
-    QDirIterator it(pDirectory, QStringList() << "*", QDir::NoFilter, QDirIterator::Subdirectories);
-    while (it.hasNext())
-    {
-        QString itPath = it.next();
+    mReplayDrainTimer.stop();
+    if (drained)
+        qDebug() << "Session replay finished";
+    else
+        qWarning() << "Session replay finished with" << mLatencyTracer.openTraceCount() << "traces still open";
 
-        QFile f(itPath);
-        if (!f.open(QIODevice::ReadWrite))
-            continue;
+    // Back to the server that was followed before the replay
+    mReplaying = false;
+    if (!m_activeServerIp.isEmpty())
+        socket->open(QUrl(QString("ws://%1").arg(m_activeServerIp)));
 
-        success &= f.remove();
-        f.close();
-    }
+    emit replayFinished();
+}
 
-    return success;
+void ApplicationControl::setFileSystemModel(FsProxyModel *pFsModel)
+{
+    mFsModel = pFsModel;
 }
 
-void ApplicationControl::onBinaryMessageReceived(const QByteArray &pMessage)
+void ApplicationControl::updateMemoryUsage()
 {
-    if (this->isProcessing())
+    qint64 pendingBytes = mSyncWorker->pendingBytes();
+    qint64 processBytes = FrameProfiler::processResidentBytes();
+
+    // Enforce budgets before reporting
+    if (mMemoryBudgets.pendingMessages > 0 && pendingBytes > mMemoryBudgets.pendingMessages)
     {
-        mBinaryMessageQueue.enqueue(pMessage);
-        return;
+        qint64 freedBytes = mSyncWorker->dropSupersededMessages();
+        qDebug() << "Pending messages over budget, dropped" << megabytes(freedBytes) << "of superseded messages";
+        pendingBytes -= freedBytes;
     }
 
-    setStatus("Loading assets...");
-    setIsProcessing(true);
-
-    if (mAssetImporter.isRunning())
+    if (mMemoryBudgets.process > 0 && processBytes > mMemoryBudgets.process)
     {
-        return;
+        qDebug() << "Process over budget (" << megabytes(processBytes) << "), trimming caches";
+        mComponentWarmer.invalidate();
+        if (mEngine)
+            mEngine->trimComponentCache();
+        QMetaObject::invokeMethod(mSyncWorker, "trimCaches", Qt::QueuedConnection);
     }
 
-    mAssetImporter.messageToProcess = pMessage;
-    mAssetImporter.mWritePath = mWritePath;
-    mAssetImporter.start();
+    QVariantMap usage
+    {
+        { "pendingMessages", pendingBytes },
+        { "assetImport", mSyncWorker->importBytes() },
+        { "writeCache", mSyncWorker->cacheBytes() },
+        { "memoryFiles", mMemoryStore.bytes() },
+        { "fileTree", mFsModel ? mFsModel->memoryUsage() : 0 },
+        { "process", processBytes }
+    };
+    setMemoryUsage(usage);
+
+    qInfo().noquote() << QString("Memory: pending messages %1, asset import %2, write cache %3, memory files %4, file tree %5, process %6")
+                         .arg(megabytes(pendingBytes))
+                         .arg(megabytes(usage["assetImport"].toLongLong()))
+                         .arg(megabytes(usage["writeCache"].toLongLong()))
+                         .arg(megabytes(usage["memoryFiles"].toLongLong()))
+                         .arg(megabytes(usage["fileTree"].toLongLong()))
+                         .arg(megabytes(processBytes));
 }
 
 void ApplicationControl::clearComponentCache()
@@ -461,124 +445,148 @@ void ApplicationControl::clearComponentCache()
     //    mEngine->clearComponentCache();
 }
 
-void ApplicationControl::handleAssetImportResults()
+void ApplicationControl::handleAssetImportResults(const QString &pErrorString)
 {
-    if (mAssetImporter.errorString.isEmpty())
-    {
+    if (pErrorString.isEmpty())
         setStatus("Assets loaded.");
-        mAssetImporter.wait(500); // ensure the thread finishes and drops file handles
-
-        setCurrentProjectPath(mAssetImporter.projectDir);
-        if (!mAssetImporter.folderChangeMessage.isEmpty())
-            handleFolderChangeMessage(mAssetImporter.folderChangeMessage);
-    }
     else
-    {
-        setStatus(mAssetImporter.errorString);
-    }
-    setIsProcessing(false);
+        setStatus(pErrorString);
 
-    // Nevertheless, dequeue messages
-    while (!mTextMessageQueue.isEmpty())
-    {
-        onTextMessageReceived(mTextMessageQueue.dequeue());
-    }
-    // For the moment, we'll try not dequeuing binary messages (they may be spammed by server)
-//    while (!mBinaryMessageQueue.isEmpty())
-//    {
-//        onBinaryMessageReceived(mBinaryMessageQueue.dequeue());
-//    }
+    // Later imports are already queued on the sync thread
+    mPendingImports = qMax(0, mPendingImports - 1);
+    setIsProcessing(mPendingImports > 0);
 }
 
-void ApplicationControl::handleFolderChangeMessage(const QString &pMessage)
+void ApplicationControl::handleWriteStatsChanged(int pWritten, int pSkipped, qint64 pBytesSaved)
 {
-//    qDebug () << "handleFolderChangeMessage" << pMessage;
-
-    // Retrieve distant folder name
-    QString folderName = messageContent(pMessage, "folder").remove("\n");
-    folderName.remove("file:///");
-    setCurrentFolder(folderName);
-    qDebug() << "FOLDER: " << folderName;
+    setWriteStats(QVariantMap
+    {
+        { "written", pWritten },
+        { "skipped", pSkipped },
+        { "bytesSaved", pBytesSaved }
+    });
+}
 
-    // Ensure destination folder exists
-    QString projectName = folderName.mid(folderName.lastIndexOf("/") + 1);
+QString ApplicationControl::addSession(const QString &pServerAddress)
+{
+    QString id = QString("session%1").arg(mNextSessionId++);
 
-    QString projectPath =  projectsPath() + projectName;
-    setCurrentProjectPath(projectPath);
-    QDir().mkpath(m_currentProjectPath);
+    // Sessions have their own projects and blobs: they never write to the same files
+    SyncSession* session = new SyncSession(id, pServerAddress, mWritePath + "/sessions/" + id);
+    connect(session, &SyncSession::changed, this, &ApplicationControl::refreshSessions);
+    mSessions.insert(id, session);
+    session->start();
 
-    // Refresh file contents
-    int lastFileIndex = 0;
+    refreshSessions();
+    return id;
+}
 
-    QString currentFileName = messageContent(pMessage, "file");
-    QString currentFileContent = messageContent(pMessage, "content");
+bool ApplicationControl::removeSession(const QString &pId)
+{
+    SyncSession* session = mSessions.take(pId);
+    if (!session)
+        return false;
 
-    while (!currentFileName.isEmpty())
-    {
-        QString localFileName = currentFileName.remove(folderName);
-        localFileName = localFileName.startsWith("/") ? localFileName.remove(0,1) : localFileName;
-        qDebug() << "localFileName: " << localFileName;
+    delete session;
+    refreshSessions();
+    return true;
+}
 
-        createFile(m_currentProjectPath,
-                   localFileName,
-                   currentFileContent);
+void ApplicationControl::refreshSessions()
+{
+    QVariantList sessions;
+    for (SyncSession* session: mSessions)
+        sessions.append(session->toVariantMap());
+    setSessions(sessions);
+}
 
-        lastFileIndex = pMessage.indexOf(endTag("content"), lastFileIndex) + endTag("content").length();
-        currentFileName = messageContent(pMessage, "file", lastFileIndex);
-        currentFileContent = messageContent(pMessage, "content", lastFileIndex);
-    }
+void ApplicationControl::openCachedProject(const QString &pName)
+{
+    QMetaObject::invokeMethod(mSyncWorker, "openCachedProject", Qt::QueuedConnection, Q_ARG(QString, pName));
+}
 
-    // Clear component cache
-//    ->trimComponentCache();
-//    mEngine->clearComponentCache();
+void ApplicationControl::invalidateCachedProject(const QString &pPath)
+{
+    // Edited locally: the disk has the latest content
+    mMemoryStore.remove(pPath);
+    mComponentWarmer.invalidate();
 
-    // Check for a current file change
-    handleCurrentFileChangeMessage(pMessage);
+    // After the messages already queued, which may write to the same project
+    QMetaObject::invokeMethod(mSyncWorker, "invalidateCachedProject", Qt::QueuedConnection, Q_ARG(QString, pPath));
 }
 
-void ApplicationControl::handleFileChangeMessage(const QString &pMessage)
+void ApplicationControl::restoreLastProject()
 {
-    // Find the corresponding local file
-    QString currentFileName = messageContent(pMessage, "file");
-    if (currentFileName.isEmpty())
+    if (mRestoredFile.isEmpty() || !m_currentFile.isEmpty())
         return;
 
-    QString currentFileContent = messageContent(pMessage, "content");
-
-    QString currentFileNameLocal = localFilePathFromRemoteFilePath(currentFileName);
+    qDebug() << "Showing cached project" << mRestoredFile;
+    setStatus("Cached version, waiting for the server...");
+    setCurrentFile(mRestoredFile);
+}
 
-    // Replace contents
-    createFile(m_currentProjectPath, currentFileNameLocal, currentFileContent);
+bool ApplicationControl::isWebViewRequired()
+{
+    return QSettings().value("startup/webView", false).toBool();
+}
 
-    // Check for a current file change
-    handleCurrentFileChangeMessage(pMessage);
+void ApplicationControl::setWebViewInitialized(bool pInitialized)
+{
+    mWebViewInitialized = pInitialized;
 }
 
-void ApplicationControl::handleCurrentFileChangeMessage(const QString &pMessage)
+void ApplicationControl::handleWebViewRequired(bool pRequired)
 {
-    // Extract current file from message
-    QString currentFileDistant = messageContent(pMessage, "currentfile");
-    if (currentFileDistant.isEmpty())
+    // Remembered for the next launch
+    if (pRequired != isWebViewRequired())
+        QSettings().setValue("startup/webView", pRequired);
+
+    if (!pRequired || mWebViewInitialized)
         return;
 
-    // TODO: fix urls such as C:\Users\user\folder\file:///C:\Users\user\folder\main.qml
-    QString currentFileLocal = localFilePathFromRemoteFilePath(currentFileDistant);
-    setCurrentFile(""); // Necessary to force a reload of loaders, even after having cleared the qmlengine cache
-//    mEngine->clearComponentCache(); // do not do that here, otherwise the websocket is recreated...
-    setCurrentFile(currentFileLocal);
+#if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
+    // Native web views need no shared context: they can be initialized late
+    QtWebView::initialize();
+    mWebViewInitialized = true;
+#else
+    // Only with startup/lazyWebView: Qt WebEngine shares its OpenGL context with the scene graph,
+    // which must be set up before the window
+    setStatus("This project uses QtWebView: restart the client to display it.");
+#endif
 }
 
-QString ApplicationControl::localFilePathFromRemoteFilePath(const QString &pRemoteFile)
+void ApplicationControl::handleProjectReady(const QString &pFolder, const QString &pProjectPath)
 {
-    QString localFile = pRemoteFile;
-    localFile.remove(this->currentFolder());
-    localFile.remove("file:///");
-    if (localFile.startsWith("/"))
-        localFile.remove(0,1);
+    mComponentWarmer.invalidate();
+
+    setCurrentFolder(pFolder);
+    setCurrentProjectPath(pProjectPath);
+
+    if (!mReplaying && mLastProjectRecorded)
+    {
+        QSettings settings;
+        settings.setValue("lastProject/folder", pFolder);
+        settings.setValue("lastProject/projectPath", pProjectPath);
+    }
 
-    localFile = "file:///" + m_currentProjectPath + "/" + localFile;
+    // The server version replaces the cached one
+    if (!mRestoredFile.isEmpty())
+    {
+        mRestoredFile.clear();
+        setStatus("");
+    }
+}
 
-    return localFile;
+void ApplicationControl::handleCurrentFileReady(const QString &pCurrentFile)
+{
+    mComponentWarmer.invalidate();
+
+    // Same file with new contents: reload it anyway
+//    mEngine->clearComponentCache(); // do not do that here, otherwise the websocket is recreated...
+    if (m_currentFile == pCurrentFile)
+        mReloadScheduler.requestReload(pCurrentFile);
+    else
+        setCurrentFile(pCurrentFile);
 }
 
 void ApplicationControl::processPendingDatagrams()
@@ -682,6 +690,96 @@ QQmlEngine *ApplicationControl::engine() const
 void ApplicationControl::setEngine(QQmlEngine *engine)
 {
     mEngine = engine;
+
+    // Before the engine loads anything
+    if (mEngine && mServeFromMemory)
+        mEngine->setNetworkAccessManagerFactory(&mNetworkAccessManagerFactory);
+
+    // Warmed documents must be compiled from the very URLs the reloads use
+    mComponentWarmer.setEngine(mEngine);
+    mComponentWarmer.setUrlMapper([=](const QString& pSource) { return documentUrl(pSource); });
+}
+
+QUrl ApplicationControl::documentUrl(const QString &pSource) const
+{
+    return mServeFromMemory && mEngine ? MemoryFileStore::toUrl(pSource) : QUrl(pSource);
+}
+
+void ApplicationControl::setWarmUpEnabled(bool pEnabled)
+{
+    mComponentWarmer.setEnabled(pEnabled);
+}
+
+void ApplicationControl::setReloadCoalescing(bool pEnabled)
+{
+    mReloadScheduler.setCoalescing(pEnabled);
+}
+
+void ApplicationControl::setLastProjectRecorded(bool pEnabled)
+{
+    mLastProjectRecorded = pEnabled;
+}
+
+void ApplicationControl::setWindow(QQuickWindow *pWindow)
+{
+    mReloadScheduler.setWindow(pWindow);
+    mFrameProfiler.setWindow(pWindow);
+
+    // Emitted on the render thread
+    if (pWindow)
+        connect(pWindow, &QQuickWindow::frameSwapped, this, [=]()
+        {
+            mLatencyTracer.markPending(LatencyTracer::FrameSwapped);
+        }, Qt::DirectConnection);
+}
+
+void ApplicationControl::documentLoaded()
+{
+    mLatencyTracer.markPending(LatencyTracer::LoaderReady);
+    mReloadScheduler.documentLoaded();
+    mFrameProfiler.setDocument(m_currentFile);
+
+    // The other documents of the project compile while this one is shown
+    mComponentWarmer.warmUp(m_currentProjectPath, m_currentFile);
+}
+
+QVariantMap ApplicationControl::frameStatistics() const
+{
+    return mFrameProfiler.statistics();
+}
+
+void ApplicationControl::sendTelemetry()
+{
+    if (mReplaying || socket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    socket->sendTextMessage(mFrameProfiler.telemetryMessage());
+}
+
+QVariantMap ApplicationControl::latencyStatistics() const
+{
+    return mLatencyTracer.statistics();
+}
+
+QString ApplicationControl::latencyReportJson() const
+{
+    return QString::fromUtf8(mLatencyTracer.toJson());
+}
+
+bool ApplicationControl::dumpLatencyReport(QString pFilePath)
+{
+    if (pFilePath.isEmpty())
+        pFilePath = mWritePath + "/latency.json";
+    pFilePath.replace("file:///", "");
+
+    QFile file(pFilePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Could not write latency report to" << pFilePath;
+        return false;
+    }
+    file.write(mLatencyTracer.toJson());
+    return true;
 }
 
 QString ApplicationControl::currentFile() const
@@ -702,7 +800,13 @@ void ApplicationControl::setCurrentFile(QString currentFile)
     m_currentFile = currentFile;
     emit currentFileChanged(m_currentFile);
 
-    qDebug() << "Current file changed " << currentFile;
+    qCDebug(lcApp) << "Current file changed" << currentFile;
+
+    if (!mReplaying && mLastProjectRecorded)
+        QSettings().setValue("lastProject/file", currentFile);
+
+    // Near-instant when the document was warmed up
+    mReloadScheduler.requestReload(m_currentFile, mComponentWarmer.warmedSource(m_currentFile));
 }
 
 void ApplicationControl::setCurrentFolder(QString currentFolder)
@@ -713,7 +817,7 @@ void ApplicationControl::setCurrentFolder(QString currentFolder)
     m_currentFolder = currentFolder;
     emit currentFolderChanged(m_currentFolder);
 
-    qDebug() << "Current folder changed " << currentFolder;
+    qCDebug(lcApp) << "Current folder changed" << currentFolder;
 }
 
 
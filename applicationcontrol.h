@@ -5,40 +5,30 @@
 #include <QQmlEngine>
 
 QT_BEGIN_NAMESPACE
+class QQuickWindow;
 class QUdpSocket;
 QT_END_NAMESPACE
 
+class FsProxyModel;
+
 #include "macros.h"
 #include <QHostAddress>
 #include <QWebSocket>
 #include <QUdpSocket>
 #include <QThread>
-#include <QMutex>
 #include <QQueue>
-
-class AssetImporter : public QThread
-{
-    Q_OBJECT
-
-public:
-    QByteArray messageToProcess;
-    QString errorString;
-
-    // TODO: refactor this one
-    QString mWritePath;
-
-    QString projectDir;
-    QString folderChangeMessage;
-
-    // QThread interface
-protected:
-    virtual void run() override;
-
-    bool deleteDirectory(const QString& pDirectory);
-
-    QMutex mutex;
-};
-
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "asyncfileio.h"
+#include "componentwarmer.h"
+#include "frameprofiler.h"
+#include "latencytracer.h"
+#include "memoryfilestore.h"
+#include "reloadscheduler.h"
+#include "sessionrecorder.h"
+#include "syncsession.h"
+#include "syncworker.h"
 
 class ApplicationControl: public QObject
 {
@@ -56,8 +46,27 @@ class ApplicationControl: public QObject
     PROPERTY(QString, projectsPath, setProjectsPath)
     PROPERTY(QString, deleteFileSystemEntryError, setDeleteFileSystemEntryError)
 
+    // Files written / skipped (unchanged) / bytes saved by the sync thread since launch
+    READONLY_PROPERTY(QVariantMap, writeStats, setWriteStats)
+
+    // Bytes held per subsystem, refreshed periodically (see updateMemoryUsage)
+    READONLY_PROPERTY(QVariantMap, memoryUsage, setMemoryUsage)
+
+    // Projects kept on disk, most recently used first ({ name, size, lastUsed })
+    READONLY_PROPERTY(QVariantList, cachedProjects, setCachedProjects)
+
+    // Additional servers followed in the background (see SyncSession)
+    READONLY_PROPERTY(QVariantList, sessions, setSessions)
+
+    // Times the frames of the window, for the overlay and the server (see FrameProfiler)
+    PROPERTY(bool, frameProfilerEnabled, setFrameProfilerEnabled)
+
+    // Launch time per phase, from process start to the first frame (see StartupTrace)
+    READONLY_PROPERTY(QVariantMap, startupTrace, setStartupTrace)
+
 public:
-    explicit ApplicationControl(QObject *parent = nullptr);
+    // Projects, sessions and reports go to pWritePath (default: qmlplaygroundclient_cache in the documents)
+    explicit ApplicationControl(const QString& pWritePath = QString(), QObject *parent = nullptr);
     ~ApplicationControl();
 
     Q_INVOKABLE bool createFolder(QString pPath, QString pFolderName);
@@ -67,6 +76,12 @@ public:
     Q_INVOKABLE bool writeFileContents(const QString& pFilePath, const QString& pFileContents);
     Q_INVOKABLE bool deleteFileSystemEntry(const QString& pFilePath);
 
+    // Same off the GUI thread, in call order, with a callback instead of a result (see AsyncFileIo)
+    Q_INVOKABLE void readFileContentsAsync(const QString& pFilePath, const QJSValue& pCallback);
+    Q_INVOKABLE void readFileRangeAsync(const QString& pFilePath, qint64 pOffset, qint64 pLength, const QJSValue& pCallback);
+    Q_INVOKABLE void readFileChunksAsync(const QString& pFilePath, int pChunkSize, const QJSValue& pCallback);
+    Q_INVOKABLE void writeFileContentsAsync(const QString& pFilePath, const QString& pFileContents, const QJSValue& pCallback = QJSValue());
+
     // TODO
     Q_INVOKABLE void addContextProperty(const QString& pKey, QVariant pData);
     Q_INVOKABLE void onTextMessageReceived(const QString& pMessage);
@@ -80,6 +95,59 @@ public:
     QQmlEngine* engine() const;
     void setEngine(QQmlEngine *engine);
 
+    // Reloads of the current file are aligned on the frames of this window
+    void setWindow(QQuickWindow* pWindow);
+
+    // URL the engine loads a reload source from
+    QUrl documentUrl(const QString& pSource) const;
+
+    // Compile the other documents of the project in the background (on by default)
+    void setWarmUpEnabled(bool pEnabled);
+
+    // Reload only the latest document pushed while one loads (on by default)
+    void setReloadCoalescing(bool pEnabled);
+
+    // Remember the last project, restored at the next launch (on by default)
+    void setLastProjectRecorded(bool pEnabled);
+    Q_INVOKABLE void documentLoaded();
+
+    // Last period of the frame profiler (see FrameProfiler::statistics)
+    Q_INVOKABLE QVariantMap frameStatistics() const;
+
+    // Edit-to-pixel latency, per stage (see LatencyTracer)
+    Q_INVOKABLE QVariantMap latencyStatistics() const;
+    Q_INVOKABLE QString latencyReportJson() const;
+    Q_INVOKABLE bool dumpLatencyReport(QString pFilePath = QString());
+
+    // Recent log messages (see LogRingBuffer): written next to the cache by default, or sent to the server
+    Q_INVOKABLE QString recentLog() const;
+    Q_INVOKABLE bool dumpLog(QString pFilePath = QString());
+    Q_INVOKABLE bool sendLog();
+
+    // Record incoming websocket frames, and replay them offline (speed 0 = as fast as possible)
+    Q_INVOKABLE bool startRecording(const QString& pFilePath);
+    Q_INVOKABLE void stopRecording();
+    Q_INVOKABLE bool replaySession(const QString& pFilePath, double pSpeed = 1.0);
+
+    // Accounts for the file tree in memoryUsage
+    void setFileSystemModel(FsProxyModel* pFsModel);
+    Q_INVOKABLE void updateMemoryUsage();
+
+    // Follow another server in the background, on a thread of its own. Returns the session id.
+    Q_INVOKABLE QString addSession(const QString& pServerAddress);
+    Q_INVOKABLE bool removeSession(const QString& pId);
+
+    // Shows a cached project without waiting for the server to push it again
+    Q_INVOKABLE void openCachedProject(const QString& pName);
+
+    // Shows the last project from the cache while the server is discovered. Call once QML is loaded.
+    void restoreLastProject();
+
+    // On mobile (and on desktop with startup/lazyWebView), QtWebView is only initialized at startup
+    // when the last project imported it
+    static bool isWebViewRequired();
+    void setWebViewInitialized(bool pInitialized);
+
     Q_INVOKABLE QString messageContent(const QString& message,
                                        const QString& tag,
                                        int fromIndex = 0);
@@ -96,6 +164,12 @@ signals:
 
     void jsonMessage(QString message);
 
+    // Set this source on the content Loader (a cache-busting suffix is included)
+    void reloadRequested(QString source);
+
+    // Once the replayed messages are processed and displayed, or after a timeout
+    void replayFinished();
+
     void availableAddressesChanged(QStringList availableAddresses);
 
 public slots:
@@ -103,12 +177,16 @@ public slots:
     void setCurrentFolder(QString currentFolder);
 
 protected:
-    void handleFolderChangeMessage(const QString &pMessage);
-    void handleFileChangeMessage(const QString &pMessage);
-    void handleCurrentFileChangeMessage(const QString &pMessage);
-    void handleAssetImportResults();
-
-    QString localFilePathFromRemoteFilePath(const QString& pRemoteFile);
+    void handleProjectReady(const QString& pFolder, const QString& pProjectPath);
+    void handleCurrentFileReady(const QString& pCurrentFile);
+    void handleAssetImportResults(const QString& pErrorString);
+    void handleWriteStatsChanged(int pWritten, int pSkipped, qint64 pBytesSaved);
+    void handleWebViewRequired(bool pRequired);
+    void invalidateCachedProject(const QString& pPath);
+    void requestResync(const QString& pRemoteFile);
+    void sendTelemetry();
+    void refreshSessions();
+    void finishReplay();
 
 protected slots:
     void processPendingDatagrams();
@@ -128,10 +206,47 @@ private:
     QHostAddress groupAddress4;
     QHostAddress groupAddress6;
 
-    QQueue<QByteArray> mBinaryMessageQueue;
-    QQueue<QString> mTextMessageQueue;
+    int mPendingImports = 0;
+
+    LatencyTracer mLatencyTracer;
+    FrameProfiler mFrameProfiler;
+    AsyncFileIo mFileIo;
+
+    // Budgets in bytes, 0 means unbounded (QSettings "memory/..." keys)
+    struct MemoryBudgets
+    {
+        qint64 pendingMessages = 0;
+        qint64 process = 0;
+    } mMemoryBudgets;
+    QTimer mMemoryTimer;
+    FsProxyModel* mFsModel = nullptr;
+
+    SessionRecorder mSessionRecorder;
+    SessionPlayer mSessionPlayer;
+    bool mReplaying = false;
+    QTimer mReplayDrainTimer; // until the last replayed messages are displayed
+    QElapsedTimer mReplayDrainClock;
+    bool mLastProjectRecorded = true;
+
+    bool mWebViewInitialized = false;
+
+    // Last project shown, from the previous launch
+    QString mRestoredFile;
+
+    // Project text files, served to the engine under qmlmem:// (QSettings "sync/serveFromMemory")
+    MemoryFileStore mMemoryStore;
+    MemoryNetworkAccessManagerFactory mNetworkAccessManagerFactory;
+    bool mServeFromMemory = false;
+
+    // Text messages are parsed and written on the sync thread, in arrival order
+    QThread mSyncThread;
+    SyncWorker* mSyncWorker = nullptr;
+
+    ReloadScheduler mReloadScheduler;
+    ComponentWarmer mComponentWarmer;
 
-    AssetImporter mAssetImporter;
+    QMap<QString, SyncSession*> mSessions;
+    int mNextSessionId = 1;
 };
 
 #endif // APPLICATIONCONTROL_H
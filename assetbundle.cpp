@@ -0,0 +1,386 @@
+#include "assetbundle.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+const char kMagic[] = "QPB1";
+const int kMagicSize = 4;
+
+// LZ4 block constraints: the last 5 bytes are literals, and the last match starts 12 bytes before the end
+const int kMinMatch = 4;
+const int kLastLiterals = 5;
+const int kMatchLimit = 12;
+const int kMaxOffset = 65535;
+const int kHashBits = 14;
+
+// Not worth compressing again
+const char* const kStoredSuffixes[] = { "png", "jpg", "jpeg", "gif", "webp", "ktx", "astc", "ogg", "mp3", "wav",
+                                        "mp4", "webm", "zip", "gz", "ttf", "otf", "woff", "woff2" };
+
+quint32 read32(const uchar* pData)
+{
+    quint32 value;
+    std::memcpy(&value, pData, sizeof(value));
+    return value;
+}
+
+quint32 hash(quint32 pValue)
+{
+    return (pValue * 2654435761u) >> (32 - kHashBits);
+}
+
+void appendLength(QByteArray& pOut, int pLength)
+{
+    while (pLength >= 255)
+    {
+        pOut.append(char(255));
+        pLength -= 255;
+    }
+    pOut.append(char(pLength));
+}
+
+void appendSequence(QByteArray& pOut, const uchar* pLiterals, int pLiteralLength, int pOffset, int pMatchLength)
+{
+    int matchCode = pMatchLength - kMinMatch;
+    pOut.append(char((qMin(pLiteralLength, 15) << 4) | (pMatchLength > 0 ? qMin(matchCode, 15) : 0)));
+    if (pLiteralLength >= 15)
+        appendLength(pOut, pLiteralLength - 15);
+    pOut.append(reinterpret_cast<const char*>(pLiterals), pLiteralLength);
+
+    // The last sequence is literals only
+    if (pMatchLength == 0)
+        return;
+
+    pOut.append(char(pOffset & 0xff));
+    pOut.append(char(pOffset >> 8));
+    if (matchCode >= 15)
+        appendLength(pOut, matchCode - 15);
+}
+
+bool readLength(const uchar*& pIn, const uchar* pEnd, int& pLength)
+{
+    uchar byte;
+    do
+    {
+        if (pIn >= pEnd)
+            return false;
+        byte = *pIn++;
+        pLength += byte;
+        if (pLength < 0)
+            return false;
+    }
+    while (byte == 255);
+    return true;
+}
+}
+
+// ---------------------------------------------------------------
+// AssetBundle
+// ---------------------------------------------------------------
+
+const char* const AssetBundle::kFormatName = "qpb1";
+
+bool AssetBundle::isBundle(const QByteArray &pData)
+{
+    return pData.startsWith(kMagic);
+}
+
+bool AssetBundle::read(const QByteArray &pData)
+{
+    mEntries.clear();
+    mErrorString.clear();
+
+    if (!isBundle(pData))
+    {
+        mErrorString = "Not an asset bundle";
+        return false;
+    }
+
+    QDataStream stream(pData);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.skipRawData(kMagicSize);
+
+    quint32 entryCount;
+    stream >> entryCount;
+    for (quint32 i = 0; i < entryCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Entry entry;
+        quint8 type, codec;
+        quint64 offset, storedSize, size;
+        stream >> entry.path >> type >> codec >> entry.permissions >> entry.crc >> offset >> storedSize >> size;
+        entry.type = EntryType(type);
+        entry.codec = Codec(codec);
+        entry.offset = qint64(offset);
+        entry.storedSize = qint64(storedSize);
+        entry.size = qint64(size);
+        mEntries.append(entry);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        mErrorString = "Truncated asset bundle index";
+        mEntries.clear();
+        return false;
+    }
+
+    qint64 dataStart = stream.device()->pos();
+    mData = pData.constData() + dataStart;
+    mDataSize = pData.size() - dataStart;
+
+    // The index comes from the network: no sum of its values may overflow, and an entry may not
+    // decode to more than its LZ4 block can hold (255 bytes per byte, at most)
+    for (const Entry& entry: mEntries)
+    {
+        bool valid = entry.type <= SymLink && entry.codec <= Lz4 &&
+                     entry.offset >= 0 && entry.offset <= mDataSize &&
+                     entry.storedSize >= 0 && entry.storedSize <= mDataSize - entry.offset &&
+                     entry.size >= 0 && entry.size < std::numeric_limits<int>::max() &&
+                     (entry.codec != Stored || entry.size == entry.storedSize) &&
+                     (entry.codec != Lz4 || entry.size <= entry.storedSize * 255 + 16) &&
+                     !entry.path.isEmpty() && !QFileInfo(entry.path).isAbsolute() && !entry.path.split('/').contains("..");
+        if (!valid)
+        {
+            mErrorString = "Invalid asset bundle entry " + entry.path;
+            mEntries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+QString AssetBundle::errorString() const
+{
+    return mErrorString;
+}
+
+const QVector<AssetBundle::Entry> &AssetBundle::entries() const
+{
+    return mEntries;
+}
+
+QByteArray AssetBundle::entryData(const Entry &pEntry, bool *pOk) const
+{
+    const char* stored = mData + pEntry.offset;
+    QByteArray data;
+    bool ok = true;
+
+    if (pEntry.codec == Stored)
+    {
+        data = QByteArray(stored, int(pEntry.storedSize));
+    }
+    else
+    {
+        data.resize(int(pEntry.size));
+        ok = decompress(stored, int(pEntry.storedSize), data.data(), data.size());
+    }
+
+    ok = ok && crc32(data.constData(), data.size()) == pEntry.crc;
+    if (pOk)
+        *pOk = ok;
+    return ok ? data : QByteArray();
+}
+
+quint32 AssetBundle::crc32(const char *pData, qint64 pSize)
+{
+    static const QVector<quint32> table = []()
+    {
+        QVector<quint32> table(256);
+        for (quint32 i = 0; i < 256; ++i)
+        {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            table[int(i)] = crc;
+        }
+        return table;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar* data = reinterpret_cast<const uchar*>(pData);
+    for (qint64 i = 0; i < pSize; ++i)
+        crc = table.at((crc ^ data[i]) & 0xff) ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+QByteArray AssetBundle::compress(const QByteArray &pData)
+{
+    const uchar* data = reinterpret_cast<const uchar*>(pData.constData());
+    const int size = pData.size();
+
+    QByteArray out;
+    out.reserve(size + size / 255 + 16);
+
+    // Greedy: the last position of each hashed 4-byte sequence is the match candidate
+    QVector<int> table(1 << kHashBits, -1);
+    int anchor = 0;
+    int position = 0;
+    while (position < size - kMatchLimit)
+    {
+        quint32 sequence = read32(data + position);
+        quint32 slot = hash(sequence);
+        int candidate = table.at(int(slot));
+        table[int(slot)] = position;
+
+        if (candidate < 0 || position - candidate > kMaxOffset || read32(data + candidate) != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        int matchLength = kMinMatch;
+        int maxLength = size - kLastLiterals - position;
+        while (matchLength < maxLength && data[position + matchLength] == data[candidate + matchLength])
+            matchLength++;
+
+        appendSequence(out, data + anchor, position - anchor, position - candidate, matchLength);
+        position += matchLength;
+        anchor = position;
+    }
+
+    appendSequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool AssetBundle::decompress(const char *pSource, int pSourceSize, char *pDestination, int pDestinationSize)
+{
+    const uchar* in = reinterpret_cast<const uchar*>(pSource);
+    const uchar* inEnd = in + pSourceSize;
+    uchar* out = reinterpret_cast<uchar*>(pDestination);
+    uchar* outEnd = out + pDestinationSize;
+
+    while (in < inEnd)
+    {
+        uchar token = *in++;
+
+        int literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(in, inEnd, literalLength))
+            return false;
+        if (literalLength > inEnd - in || literalLength > outEnd - out)
+            return false;
+        std::memcpy(out, in, size_t(literalLength));
+        in += literalLength;
+        out += literalLength;
+
+        // Last sequence
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+        int offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out - reinterpret_cast<uchar*>(pDestination))
+            return false;
+
+        int matchLength = token & 15;
+        if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+            return false;
+        matchLength += kMinMatch;
+        if (matchLength > outEnd - out)
+            return false;
+
+        // Overlapping matches repeat the last bytes: copied one by one
+        const uchar* match = out - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(out, match, size_t(matchLength));
+            out += matchLength;
+        }
+        else
+        {
+            for (int i = 0; i < matchLength; ++i)
+                *out++ = *match++;
+        }
+    }
+
+    return out == outEnd;
+}
+
+// ---------------------------------------------------------------
+// AssetBundleWriter
+// ---------------------------------------------------------------
+
+void AssetBundleWriter::addFile(const QString &pPath, const QByteArray &pContent, quint32 pPermissions)
+{
+    AssetBundle::Entry entry;
+    entry.path = pPath;
+    entry.type = AssetBundle::File;
+    entry.permissions = pPermissions;
+    entry.crc = AssetBundle::crc32(pContent.constData(), pContent.size());
+    entry.size = pContent.size();
+
+    QString suffix = QFileInfo(pPath).suffix().toLower();
+    for (const char* storedSuffix: kStoredSuffixes)
+    {
+        if (suffix == QLatin1String(storedSuffix))
+        {
+            addEntry(entry, pContent);
+            return;
+        }
+    }
+
+    // Kept only when it saves at least 1/8th
+    QByteArray compressed = AssetBundle::compress(pContent);
+    if (compressed.size() < pContent.size() - pContent.size() / 8)
+    {
+        entry.codec = AssetBundle::Lz4;
+        addEntry(entry, compressed);
+    }
+    else
+    {
+        addEntry(entry, pContent);
+    }
+}
+
+void AssetBundleWriter::addDirectory(const QString &pPath, quint32 pPermissions)
+{
+    AssetBundle::Entry entry;
+    entry.path = pPath;
+    entry.type = AssetBundle::Directory;
+    entry.permissions = pPermissions;
+    addEntry(entry, QByteArray());
+}
+
+void AssetBundleWriter::addSymLink(const QString &pPath, const QString &pTarget)
+{
+    QByteArray target = QFile::encodeName(pTarget);
+
+    AssetBundle::Entry entry;
+    entry.path = pPath;
+    entry.type = AssetBundle::SymLink;
+    entry.crc = AssetBundle::crc32(target.constData(), target.size());
+    entry.size = target.size();
+    addEntry(entry, target);
+}
+
+QByteArray AssetBundleWriter::data() const
+{
+    QByteArray bundle;
+    QDataStream stream(&bundle, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.writeRawData(kMagic, kMagicSize);
+
+    stream << quint32(mEntries.size());
+    for (const AssetBundle::Entry& entry: mEntries)
+    {
+        stream << entry.path << quint8(entry.type) << quint8(entry.codec) << entry.permissions << entry.crc
+               << quint64(entry.offset) << quint64(entry.storedSize) << quint64(entry.size);
+    }
+    stream.writeRawData(mEntryData.constData(), mEntryData.size());
+    return bundle;
+}
+
+void AssetBundleWriter::addEntry(AssetBundle::Entry pEntry, const QByteArray &pStoredData)
+{
+    pEntry.offset = mEntryData.size();
+    pEntry.storedSize = pStoredData.size();
+    mEntryData.append(pStoredData);
+    mEntries.append(pEntry);
+}
@@ -0,0 +1,96 @@
+#ifndef ASSETBUNDLE_H
+#define ASSETBUNDLE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Alternative to zip for the binary asset messages, announced by the client in its capabilities.
+// "QPB1", an index of every entry (path, codec, CRC-32, offset and sizes), then the entry data.
+// Each entry is either stored (media that is already compressed) or compressed with an LZ4 block:
+// entries can be decoded in any order and in parallel, at memory speed.
+// Only depends on QtCore: the stand-in server builds it too.
+
+// ---------------------------------------------------------------
+// AssetBundle
+// ---------------------------------------------------------------
+
+class AssetBundle
+{
+public:
+    enum Codec
+    {
+        Stored = 0,
+        Lz4 = 1
+    };
+
+    enum EntryType
+    {
+        File = 0,
+        Directory = 1,
+        SymLink = 2 // data is the link target
+    };
+
+    struct Entry
+    {
+        QString path;
+        EntryType type = File;
+        Codec codec = Stored;
+        quint32 permissions = 0;
+        quint32 crc = 0; // CRC-32 of the decoded data, as in zip files
+        qint64 offset = 0; // in the data section
+        qint64 storedSize = 0;
+        qint64 size = 0;
+    };
+
+    // Name announced in the capabilities message
+    static const char* const kFormatName;
+
+    static bool isBundle(const QByteArray& pData);
+
+    // Parses the index. pData must outlive the bundle.
+    bool read(const QByteArray& pData);
+    QString errorString() const;
+
+    const QVector<Entry>& entries() const;
+
+    // Decodes an entry and checks its CRC. Thread-safe.
+    QByteArray entryData(const Entry& pEntry, bool* pOk = nullptr) const;
+
+    static quint32 crc32(const char* pData, qint64 pSize);
+
+    // LZ4 block format
+    static QByteArray compress(const QByteArray& pData);
+    static bool decompress(const char* pSource, int pSourceSize, char* pDestination, int pDestinationSize);
+
+private:
+    const char* mData = nullptr;
+    qint64 mDataSize = 0;
+    QVector<Entry> mEntries;
+    QString mErrorString;
+};
+
+// ---------------------------------------------------------------
+// AssetBundleWriter
+// ---------------------------------------------------------------
+
+class AssetBundleWriter
+{
+public:
+    // The codec is chosen per entry: stored for known compressed formats and for data LZ4 does not shrink
+    // Permissions are QFile::Permissions (rw-r--r-- and rwxr-xr-x by default)
+    void addFile(const QString& pPath, const QByteArray& pContent, quint32 pPermissions = 0x6644);
+    void addDirectory(const QString& pPath, quint32 pPermissions = 0x7755);
+    void addSymLink(const QString& pPath, const QString& pTarget);
+
+    QByteArray data() const;
+
+protected:
+    void addEntry(AssetBundle::Entry pEntry, const QByteArray& pStoredData);
+
+private:
+    QVector<AssetBundle::Entry> mEntries;
+    QByteArray mEntryData;
+};
+
+#endif // ASSETBUNDLE_H
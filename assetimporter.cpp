@@ -0,0 +1,478 @@
+#include "assetimporter.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include <private/qzipreader_p.h>
+
+#include "assetbundle.h"
+#include "blobstore.h"
+#include "logging.h"
+
+namespace
+{
+const qint64 kMaxDecodedBytes = 64 * 1024 * 1024; // held in memory at once while decoding a bundle in parallel
+}
+
+inline bool isUnchanged(const AssetImporter::Index& pPreviousIndex, const QString& pPath, quint32 pCrc, qint64 pSize,
+                        const QString& pAbsPath)
+{
+    auto previous = pPreviousIndex.constFind(pPath);
+    if (previous == pPreviousIndex.constEnd() || previous->crc != pCrc || previous->size != pSize)
+        return false;
+
+    QFileInfo fileInfo(pAbsPath);
+    return fileInfo.exists() && !fileInfo.isSymLink() && fileInfo.size() == pSize &&
+           fileInfo.lastModified().toMSecsSinceEpoch() == previous->lastModified;
+}
+
+inline void recordEntry(AssetImporter::Index& pIndex, const QString& pPath, quint32 pCrc, qint64 pSize,
+                        const QString& pAbsPath)
+{
+    AssetImporter::IndexEntry entry;
+    entry.crc = pCrc;
+    entry.size = pSize;
+    entry.lastModified = QFileInfo(pAbsPath).lastModified().toMSecsSinceEpoch();
+    pIndex.insert(pPath, entry);
+}
+
+// Without the blob store: a file of its own
+inline bool writeAsset(const QByteArray& pContent, const QString& pAbsPath, QFile::Permissions pPermissions)
+{
+    BlobStore::breakLink(pAbsPath);
+    QFile f(pAbsPath);
+    if (!f.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Could not open " << pAbsPath << "[WriteOnly]";
+        return false;
+    }
+    f.write(pContent);
+    f.setPermissions(pPermissions);
+    f.close();
+    return true;
+}
+
+// Entries whose CRC and size match the previous import, and whose file is still as extracted, are skipped
+bool customExtractAll(QZipReader& zipReader, QString destinationDir, BlobStore* blobStore,
+                      const AssetImporter::Index& previousIndex, AssetImporter::Index& index,
+                      AssetImporter::Stats& stats)
+{
+    using FileInfo = QZipReader::FileInfo;
+    QDir baseDir(destinationDir);
+
+    // create directories first
+    QVector<FileInfo> allFiles = zipReader.fileInfoList();
+    foreach (FileInfo fi, allFiles)
+    {
+        const QString absPath = destinationDir + "/" + fi.filePath;
+        if (fi.isDir)
+        {
+            if (!baseDir.mkpath(fi.filePath))
+            {
+                qDebug() << "could not create " << fi.filePath << "in" << baseDir.path();
+//                return false;
+                continue;
+            }
+            if (!QFile::setPermissions(absPath, fi.permissions))
+            {
+                qDebug() << "could not set Permissions to" << absPath << "permissions:" << fi.permissions;
+//                return false;
+                continue;
+            }
+        }
+    }
+
+    // set up symlinks
+    foreach (FileInfo fi, allFiles)
+    {
+        const QString absPath = destinationDir + "/" + fi.filePath;
+        if (fi.isSymLink)
+        {
+            QString destination = QFile::decodeName(zipReader.fileData(fi.filePath));
+            if (destination.isEmpty())
+            {
+                qDebug() << absPath << "destination is empty";
+//                return false;
+                continue;
+            }
+
+            QFileInfo linkFi(absPath);
+            if (!QFile::exists(linkFi.absolutePath()))
+                QDir::root().mkpath(linkFi.absolutePath());
+            QFile::remove(absPath); // from the previous import
+            if (!QFile::link(destination, absPath))
+            {
+                qDebug() << "Could not link" << destination << "to" << absPath;
+//                return false;
+                continue;
+            }
+            // Recorded too, or removeStaleFiles() would take it for a stale file
+            recordEntry(index, fi.filePath, fi.crc, fi.size, absPath);
+            /* cannot change permission of links
+                 if (!QFile::setPermissions(absPath, fi.permissions))
+                     return false;
+                 */
+        }
+    }
+
+    foreach (FileInfo fi, allFiles)
+    {
+        const QString absPath = destinationDir + "/" + fi.filePath;
+        if (fi.isFile)
+        {
+            if (isUnchanged(previousIndex, fi.filePath, fi.crc, fi.size, absPath))
+            {
+                index.insert(fi.filePath, previousIndex.value(fi.filePath));
+                stats.unchanged++;
+                continue;
+            }
+
+            QFileInfo qfi(absPath);
+            if (!QDir().exists(qfi.absolutePath()))
+                QDir().mkpath(qfi.absolutePath());
+
+            // Through the blob store: identical files are linked, not written again
+            // Not recorded when it failed: extracted again by the next import
+            if (blobStore)
+            {
+                if (!blobStore->materialize(zipReader.fileData(fi.filePath), absPath))
+                {
+                    qDebug() << "Could not write" << absPath;
+                    stats.failed++;
+                    continue;
+                }
+            }
+            else if (!writeAsset(zipReader.fileData(fi.filePath), absPath, fi.permissions))
+            {
+                stats.failed++;
+                continue;
+            }
+
+            recordEntry(index, fi.filePath, fi.crc, fi.size, absPath);
+            stats.extracted++;
+        }
+    }
+
+    return true;
+}
+
+void AssetImporter::run()
+{
+    errorString.clear();
+    stats = Stats();
+    QString result;
+
+    // Prepare a stream to get fields from the message
+    QByteArray message = messageToProcess;
+    QDataStream stream(&message, QIODevice::ReadOnly);
+
+    // Prepare fields that will be read
+    QString readProjectName;
+    QByteArray payload;
+    qint32 payloadSize;
+    stream >> readProjectName
+           >> payloadSize
+           >> folderChangeMessage;
+
+    // Read the payload (zip file or asset bundle)
+    payload.resize(payloadSize);
+    stream.readRawData(payload.data(), payloadSize);
+//    qDebug() << "read project name: " << readProjectName
+//             << "read payload size: " << payloadSize
+//             << "read folderchangemessage: " << folderChangeMessage;
+
+//    QString filePath = "C:/Users/vincent.ponchaut/Desktop/perso/testzipresult_client/zaza.zip";
+    QString zipFilePath = mWritePath + QString("/projects/%1/%1.zip").arg(readProjectName);
+    QFileInfo fileInfo(zipFilePath);
+    projectDir = fileInfo.absolutePath();
+
+    // Ensure resulting directory exists
+    if (!QDir().mkpath(projectDir))
+    {
+        errorString = "Error creating " + projectDir;
+        return;
+    }
+
+    // The previous import is updated in place rather than extracted again
+    const QString projectIndexPath = indexPath(readProjectName);
+    const Index previousIndex = loadIndex(projectIndexPath);
+    Index index;
+
+    bool extracted = AssetBundle::isBundle(payload) ? extractBundle(payload, previousIndex, index)
+                                                    : extractZip(payload, zipFilePath, previousIndex, index);
+    if (!extracted)
+        return;
+
+    removeStaleFiles(previousIndex, index);
+    if (!saveIndex(projectIndexPath, index))
+        qDebug() << "Could not save the asset index" << projectIndexPath;
+
+    qCDebug(lcSync) << "Assets extracted:" << stats.extracted << "unchanged:" << stats.unchanged
+                    << "removed:" << stats.removed << "failed:" << stats.failed;
+}
+
+bool AssetImporter::extractZip(const QByteArray &pPayload, const QString &pZipFilePath,
+                               const Index &pPreviousIndex, Index &pIndex)
+{
+    QFileInfo fileInfo(pZipFilePath);
+
+    // Remove previous file if it exists
+    if (fileInfo.exists() && !QFile::remove(pZipFilePath))
+    {
+        errorString = "Error removing " + pZipFilePath;
+        qDebug() << errorString;
+        return false;
+    }
+
+    // Create the resulting file
+    QFile file(pZipFilePath);
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        errorString = "Error: could not open " + pZipFilePath;
+        qDebug() << errorString;
+        return false;
+    }
+
+    // write to it
+    file.write(pPayload);
+    file.close(); // Important: close before attempting a read
+
+    // Now uncompress the data
+    QZipReader zipReader(pZipFilePath);
+    if (zipReader.status() != QZipReader::NoError)
+    {
+        QString s = zipReader.status() == QZipReader::NoError ? "NoError" :
+                    zipReader.status() == QZipReader::FileReadError ? "FileReadError" :
+                    zipReader.status() == QZipReader::FileOpenError ? "FileOpenError" :
+                    zipReader.status() == QZipReader::FilePermissionsError ? "FilePermissionsError" :
+                                                                             "FileError";
+        qDebug() << s;
+        return false;
+    }
+
+//    while (!zipReader.extractAll(projectDir))
+    while (!customExtractAll(zipReader, projectDir, blobStore, pPreviousIndex, pIndex, stats))
+    {
+        errorString = "Error: could not extract " + pZipFilePath;
+        qDebug() << errorString;
+
+        QThread::sleep(1);
+//        return;
+    }
+
+    // Remove the zip file
+    if (!file.remove())
+    {
+        qDebug() << "Could not remove " << file.fileName();
+    }
+    return true;
+}
+
+bool AssetImporter::extractBundle(const QByteArray &pPayload, const Index &pPreviousIndex, Index &pIndex)
+{
+    AssetBundle bundle;
+    if (!bundle.read(pPayload))
+    {
+        errorString = "Error: " + bundle.errorString();
+        qDebug() << errorString;
+        return false;
+    }
+
+    // Directories, links and skipped files first, in index order
+    QDir baseDir(projectDir);
+    QVector<AssetBundle::Entry> files;
+    for (const AssetBundle::Entry& entry: bundle.entries())
+    {
+        const QString absPath = projectDir + "/" + entry.path;
+        if (entry.type == AssetBundle::Directory)
+        {
+            if (!baseDir.mkpath(entry.path) || !QFile::setPermissions(absPath, QFile::Permissions(entry.permissions)))
+                qDebug() << "could not create " << entry.path << "in" << baseDir.path();
+        }
+        else if (entry.type == AssetBundle::SymLink)
+        {
+            QString destination = QFile::decodeName(bundle.entryData(entry));
+            QDir().mkpath(QFileInfo(absPath).absolutePath());
+            QFile::remove(absPath); // from the previous import
+            if (destination.isEmpty() || !QFile::link(destination, absPath))
+                qDebug() << "Could not link" << destination << "to" << absPath;
+            else
+                recordEntry(pIndex, entry.path, entry.crc, entry.size, absPath);
+        }
+        else if (isUnchanged(pPreviousIndex, entry.path, entry.crc, entry.size, absPath))
+        {
+            pIndex.insert(entry.path, pPreviousIndex.value(entry.path));
+            stats.unchanged++;
+        }
+        else
+        {
+            QDir().mkpath(QFileInfo(absPath).absolutePath());
+            files.append(entry);
+        }
+    }
+
+    // Then the files, decoded in parallel: the blob store is not thread-safe, so files going through it
+    // are materialized here, the others are written from the pool too
+    struct DecodedFile
+    {
+        AssetBundle::Entry entry;
+        QByteArray content;
+        bool ok = false;
+    };
+
+    int next = 0;
+    while (next < files.size())
+    {
+        QVector<DecodedFile> batch;
+        qint64 batchBytes = 0;
+        while (next < files.size() && (batch.isEmpty() || batchBytes + files.at(next).size <= kMaxDecodedBytes))
+        {
+            DecodedFile file;
+            file.entry = files.at(next++);
+            batchBytes += file.entry.size;
+            batch.append(file);
+        }
+
+        QtConcurrent::blockingMap(batch, [&](DecodedFile& pFile)
+        {
+            pFile.content = bundle.entryData(pFile.entry, &pFile.ok);
+            if (pFile.ok && !blobStore)
+            {
+                pFile.ok = writeAsset(pFile.content, projectDir + "/" + pFile.entry.path,
+                                      QFile::Permissions(pFile.entry.permissions));
+                pFile.content.clear();
+            }
+        });
+
+        for (const DecodedFile& file: batch)
+        {
+            const QString absPath = projectDir + "/" + file.entry.path;
+            // Not recorded: extracted again by the next import, as with a zip
+            if (!file.ok)
+            {
+                qDebug() << "Could not extract" << file.entry.path;
+                stats.failed++;
+                continue;
+            }
+
+            if (blobStore && !blobStore->materialize(file.content, absPath))
+            {
+                qDebug() << "Could not write" << absPath;
+                stats.failed++;
+                continue;
+            }
+            recordEntry(pIndex, file.entry.path, file.entry.crc, file.entry.size, absPath);
+            stats.extracted++;
+        }
+    }
+    return true;
+}
+
+QString AssetImporter::indexPath(const QString &pProjectName) const
+{
+    // Out of the projects directory, which is shown as a file tree
+    return mWritePath + "/assetindex/" + pProjectName + ".json";
+}
+
+AssetImporter::Index AssetImporter::loadIndex(const QString &pIndexPath)
+{
+    Index index;
+
+    QFile file(pIndexPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return index;
+
+    // { "relative/path": [crc, size, lastModified] }
+    QJsonObject entries = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+    {
+        QJsonArray values = it.value().toArray();
+        if (values.size() != 3)
+            continue;
+
+        IndexEntry entry;
+        entry.crc = quint32(values.at(0).toDouble());
+        entry.size = qint64(values.at(1).toDouble());
+        entry.lastModified = qint64(values.at(2).toDouble());
+        index.insert(it.key(), entry);
+    }
+    return index;
+}
+
+bool AssetImporter::saveIndex(const QString &pIndexPath, const Index &pIndex)
+{
+    QJsonObject entries;
+    for (auto it = pIndex.constBegin(); it != pIndex.constEnd(); ++it)
+        entries.insert(it.key(), QJsonArray { double(it->crc), double(it->size), double(it->lastModified) });
+
+    QDir().mkpath(QFileInfo(pIndexPath).absolutePath());
+    QSaveFile file(pIndexPath);
+    return file.open(QIODevice::WriteOnly) &&
+           file.write(QJsonDocument(entries).toJson(QJsonDocument::Compact)) >= 0 &&
+           file.commit();
+}
+
+QStringList AssetImporter::folderChangeFiles() const
+{
+    QString folder = folderChangeMessage.section("<folder>", 1).section("</folder>", 0, 0);
+    folder.remove("\n");
+    folder.remove("file:///");
+
+    QStringList files;
+    int index = folderChangeMessage.indexOf("<file>");
+    while (index >= 0)
+    {
+        int end = folderChangeMessage.indexOf("</file>", index);
+        if (end < 0)
+            break;
+
+        QString file = folderChangeMessage.mid(index + 6, end - index - 6);
+        file.remove(folder);
+        files << (file.startsWith("/") ? file.mid(1) : file);
+        index = folderChangeMessage.indexOf("<file>", end);
+    }
+    return files;
+}
+
+void AssetImporter::removeStaleFiles(const Index &pPreviousIndex, const Index &pIndex)
+{
+    auto removeFile = [this](const QString& pRelativePath)
+    {
+        // Files linked to the blob store are read-only: unlink them without opening them
+        if (QFile::remove(projectDir + "/" + pRelativePath))
+            stats.removed++;
+    };
+
+    // Without a folderchange, only the entries of the previous archive are known to be ours
+    if (folderChangeMessage.isEmpty())
+    {
+        for (auto it = pPreviousIndex.constBegin(); it != pPreviousIndex.constEnd(); ++it)
+        {
+            if (!pIndex.contains(it.key()))
+                removeFile(it.key());
+        }
+        return;
+    }
+
+    // Otherwise the project is the archive plus the text files, as when it was extracted from scratch
+    const QStringList folderChangeFileList = folderChangeFiles();
+    const QSet<QString> textFiles(folderChangeFileList.begin(), folderChangeFileList.end());
+    QDir dir(projectDir);
+    QDirIterator it(projectDir, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QString relativePath = dir.relativeFilePath(it.next());
+        if (!pIndex.contains(relativePath) && !textFiles.contains(relativePath))
+            removeFile(relativePath);
+    }
+}
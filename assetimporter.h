@@ -0,0 +1,68 @@
+#ifndef ASSETIMPORTER_H
+#define ASSETIMPORTER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+
+class BlobStore;
+
+// Extracts a binary asset message (project name + zip or AssetBundle payload) into the projects directory.
+// Runs synchronously on the sync thread, so that imports stay ordered with text messages.
+// The CRC and size of the extracted entries are kept per project: entries that did not change
+// since the last import (and were not touched on disk) are neither inflated nor written again.
+class AssetImporter
+{
+public:
+    // Extracted entry, as recorded in the index
+    struct IndexEntry
+    {
+        quint32 crc = 0;
+        qint64 size = 0;
+        qint64 lastModified = 0; // ms since epoch, of the file on disk
+    };
+    using Index = QHash<QString, IndexEntry>; // relative path -> entry
+
+    struct Stats
+    {
+        int extracted = 0;
+        int unchanged = 0;
+        int removed = 0;
+        int failed = 0; // entries that could not be decoded or written, extracted again by the next import
+    };
+
+    QByteArray messageToProcess;
+    QString errorString; // set when the import failed as a whole, failed entries are only counted in stats
+
+    // TODO: refactor this one
+    QString mWritePath;
+
+    // Optional: files are materialized as links to shared blobs
+    BlobStore* blobStore = nullptr;
+
+    QString projectDir;
+    QString folderChangeMessage;
+    Stats stats;
+
+    void run();
+
+    // Index of the entries extracted for a project, kept next to the projects directory
+    QString indexPath(const QString& pProjectName) const;
+
+protected:
+    // Each returns false when nothing was extracted
+    bool extractZip(const QByteArray& pPayload, const QString& pZipFilePath, const Index& pPreviousIndex, Index& pIndex);
+    bool extractBundle(const QByteArray& pPayload, const Index& pPreviousIndex, Index& pIndex);
+
+    static Index loadIndex(const QString& pIndexPath);
+    static bool saveIndex(const QString& pIndexPath, const Index& pIndex);
+
+    // Relative paths of the text files listed in the folderchange message
+    QStringList folderChangeFiles() const;
+
+    // Removes the files of the previous import that are neither in the archive nor in the folderchange
+    void removeStaleFiles(const Index& pPreviousIndex, const Index& pIndex);
+};
+
+#endif // ASSETIMPORTER_H
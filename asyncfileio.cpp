@@ -0,0 +1,235 @@
+#include "asyncfileio.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QTextCodec>
+#include <QtConcurrent>
+
+#include <limits>
+#include <memory>
+
+#include "blobstore.h"
+#include "memoryfilestore.h"
+
+namespace
+{
+const qint64 kMapThreshold = 64 * 1024; // bytes, smaller files are simply read
+const int kChunksInFlight = 4;          // chunks read ahead of the QML consumer
+const int kChunkReaders = 4;            // chunk reads in progress at once
+}
+
+inline QJSValue toJSValue(const QVariant& pValue)
+{
+    switch (pValue.type())
+    {
+    case QVariant::Bool:
+        return QJSValue(pValue.toBool());
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::Double:
+        return QJSValue(pValue.toDouble());
+    default:
+        return QJSValue(pValue.toString());
+    }
+}
+
+// Maps the requested byte range, or reads it for small files, and decodes it as UTF-8
+inline QString readText(QFile& pFile, qint64 pOffset, qint64 pLength, QTextDecoder& pDecoder)
+{
+    if (pLength >= kMapThreshold)
+    {
+        uchar* data = pFile.map(pOffset, pLength);
+        if (data)
+        {
+            QString text = pDecoder.toUnicode(reinterpret_cast<const char*>(data), int(pLength));
+            pFile.unmap(data);
+            return text;
+        }
+    }
+
+    pFile.seek(pOffset);
+    return pDecoder.toUnicode(pFile.read(pLength));
+}
+
+// ---------------------------------------------------------------
+// AsyncFileIo
+// ---------------------------------------------------------------
+
+AsyncFileIo::AsyncFileIo(QObject *parent)
+    : QObject(parent)
+{
+    // One at a time: a read always sees the writes requested before it
+    mPool.setMaxThreadCount(1);
+
+    // Chunk readers wait for their consumer: they run aside, once their file is open
+    mChunkPool.setMaxThreadCount(kChunkReaders);
+}
+
+AsyncFileIo::~AsyncFileIo()
+{
+    // Chunk readers may be waiting for callbacks that will never run
+    mShuttingDown.store(1);
+    mPool.clear();
+    mPool.waitForDone();
+    mChunkPool.clear();
+    mChunkPool.waitForDone();
+}
+
+QString AsyncFileIo::localPath(const QString &pFilePath)
+{
+    return MemoryFileStore::localFilePath(pFilePath);
+}
+
+void AsyncFileIo::read(const QString &pFilePath, const QJSValue &pCallback)
+{
+    readRange(pFilePath, 0, -1, pCallback);
+}
+
+void AsyncFileIo::readRange(const QString &pFilePath, qint64 pOffset, qint64 pLength, const QJSValue &pCallback)
+{
+    const quint64 callbackId = addCallback(pCallback);
+    const QString filePath = localPath(pFilePath);
+
+    QtConcurrent::run(&mPool, [=]()
+    {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            deliver(callbackId, { QString(), file.errorString() }, true);
+            return;
+        }
+
+        qint64 offset = qBound(qint64(0), pOffset, file.size());
+        qint64 length = file.size() - offset;
+        if (pLength >= 0)
+            length = qMin(length, pLength);
+
+        // A QString holds at most 2 GB: larger files are read in chunks
+        if (length > std::numeric_limits<int>::max())
+        {
+            deliver(callbackId, { QString(), QString("File too large, read it in chunks") }, true);
+            return;
+        }
+
+        QTextDecoder decoder(QTextCodec::codecForName("UTF-8"));
+        deliver(callbackId, { readText(file, offset, length, decoder), QString() }, true);
+    });
+}
+
+void AsyncFileIo::readChunks(const QString &pFilePath, int pChunkSize, const QJSValue &pCallback)
+{
+    struct ChunkState
+    {
+        QAtomicInt cancelled;
+        QSemaphore available { kChunksInFlight };
+    };
+
+    const quint64 callbackId = addCallback(pCallback);
+    const QString filePath = localPath(pFilePath);
+    const qint64 chunkSize = qMax(pChunkSize, 4096);
+    std::shared_ptr<ChunkState> state(new ChunkState);
+
+    // Opened in order with the other requests: the chunks are those of the file as of this call,
+    // even if it is replaced by a later write
+    QtConcurrent::run(&mPool, [=]()
+    {
+        std::shared_ptr<QFile> openedFile(new QFile(filePath));
+        if (!openedFile->open(QIODevice::ReadOnly))
+        {
+            deliver(callbackId, { QString(), 0, true, openedFile->errorString() }, true);
+            return;
+        }
+
+        QtConcurrent::run(&mChunkPool, [=]()
+        {
+            QFile& file = *openedFile;
+
+            // Stateful decoder: a character split across two chunks is decoded once complete
+            QTextDecoder decoder(QTextCodec::codecForName("UTF-8"));
+            const qint64 size = file.size();
+            qint64 offset = 0;
+            do
+            {
+                // Do not read ahead of the consumer more than a few chunks
+                while (!state->available.tryAcquire(1, 100))
+                {
+                    if (mShuttingDown.load())
+                        return;
+                }
+                if (state->cancelled.load())
+                {
+                    deliver(callbackId, {}, true);
+                    return;
+                }
+
+                qint64 length = qMin(chunkSize, size - offset);
+                QString chunk = readText(file, offset, length, decoder);
+                bool last = offset + length >= size;
+
+                deliver(callbackId, { chunk, offset, last, QString() }, last, [state](bool pContinue)
+                {
+                    if (!pContinue)
+                        state->cancelled.store(1);
+                    state->available.release();
+                });
+                offset += length;
+            }
+            while (offset < size);
+        });
+    });
+}
+
+void AsyncFileIo::write(const QString &pFilePath, const QString &pContents, const QJSValue &pCallback)
+{
+    const quint64 callbackId = addCallback(pCallback);
+    const QString filePath = localPath(pFilePath);
+
+    QtConcurrent::run(&mPool, [=]()
+    {
+        // Written aside then renamed: readers never see a partial file. QSaveFile refuses read-only
+        // files, so a link to a blob is removed first.
+        BlobStore::breakLink(filePath);
+        QSaveFile file(filePath);
+        QByteArray contents = pContents.toUtf8();
+        if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit())
+        {
+            deliver(callbackId, { file.errorString() }, true);
+            return;
+        }
+        deliver(callbackId, { QString() }, true);
+    });
+}
+
+quint64 AsyncFileIo::addCallback(const QJSValue &pCallback)
+{
+    quint64 callbackId = mNextCallbackId++;
+    if (pCallback.isCallable())
+        mCallbacks.insert(callbackId, pCallback);
+    return callbackId;
+}
+
+void AsyncFileIo::deliver(quint64 pCallbackId, const QVariantList &pArguments, bool pLast,
+                          std::function<void(bool)> pDelivered)
+{
+    QMetaObject::invokeMethod(this, [=]()
+    {
+        bool result = true;
+        QJSValue callback = pLast ? mCallbacks.take(pCallbackId) : mCallbacks.value(pCallbackId);
+        if (callback.isCallable() && !pArguments.isEmpty())
+        {
+            QJSValueList arguments;
+            for (const QVariant& argument: pArguments)
+                arguments.append(toJSValue(argument));
+
+            QJSValue returned = callback.call(arguments);
+            if (returned.isError())
+                qDebug() << "File callback error:" << returned.toString();
+            result = !returned.isBool() || returned.toBool();
+        }
+
+        if (pDelivered)
+            pDelivered(result);
+    }, Qt::QueuedConnection);
+}
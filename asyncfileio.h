@@ -0,0 +1,58 @@
+#ifndef ASYNCFILEIO_H
+#define ASYNCFILEIO_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QHash>
+#include <QJSValue>
+#include <QThreadPool>
+
+#include <functional>
+
+// ---------------------------------------------------------------
+// AsyncFileIo
+// ---------------------------------------------------------------
+
+// File reads and writes for QML, off the GUI thread. Requests run one at a time, in call order
+// (chunked reads only open their file in order), and their callbacks are invoked on the GUI thread.
+// Large files are read through QFile::map.
+class AsyncFileIo: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncFileIo(QObject* parent = nullptr);
+    ~AsyncFileIo();
+
+    // callback(contents, error)
+    void read(const QString& pFilePath, const QJSValue& pCallback);
+
+    // callback(contents, error): pLength bytes at most from byte pOffset (-1 for the rest of the file)
+    void readRange(const QString& pFilePath, qint64 pOffset, qint64 pLength, const QJSValue& pCallback);
+
+    // callback(chunk, offset, last, error) for each chunk of about pChunkSize bytes; return false to stop
+    void readChunks(const QString& pFilePath, int pChunkSize, const QJSValue& pCallback);
+
+    // callback(error)
+    void write(const QString& pFilePath, const QString& pContents, const QJSValue& pCallback);
+
+    static QString localPath(const QString& pFilePath);
+
+protected:
+    // QJSValues stay on the GUI thread: workers refer to callbacks by id
+    quint64 addCallback(const QJSValue& pCallback);
+
+    // Thread-safe: calls the callback on the GUI thread. The last call releases it.
+    // pDelivered (optional) is invoked on the GUI thread with the callback's return value.
+    void deliver(quint64 pCallbackId, const QVariantList& pArguments, bool pLast,
+                 std::function<void(bool)> pDelivered = nullptr);
+
+private:
+    QThreadPool mPool;
+    QThreadPool mChunkPool;
+    QAtomicInt mShuttingDown;
+    QHash<quint64, QJSValue> mCallbacks;
+    quint64 mNextCallbackId = 1;
+};
+
+#endif // ASYNCFILEIO_H
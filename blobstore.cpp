@@ -0,0 +1,178 @@
+#include "blobstore.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#if defined(Q_OS_WIN)
+#include <qt_windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const QFile::Permissions kBlobPermissions = QFile::ReadOwner | QFile::ReadUser | QFile::ReadGroup | QFile::ReadOther;
+}
+
+// Links share their permissions with the blob, and removing one needs no write permission.
+// Windows cannot remove read-only files: blobs stay writable there.
+inline void protectBlob(const QString& pBlobPath)
+{
+#if !defined(Q_OS_WIN)
+    QFile::setPermissions(pBlobPath, kBlobPermissions);
+#else
+    Q_UNUSED(pBlobPath);
+#endif
+}
+
+// ---------------------------------------------------------------
+// BlobStore
+// ---------------------------------------------------------------
+
+void BlobStore::setPath(const QString &pPath)
+{
+    mPath = pPath;
+    mLinksSupported = true;
+}
+
+bool BlobStore::materialize(const QByteArray &pContent, const QString &pFilePath)
+{
+    mStats.files++;
+
+    // Never write through an existing link, and make room for the new one
+    if (QFileInfo::exists(pFilePath))
+        QFile::remove(pFilePath);
+
+    if (!mLinksSupported || mPath.isEmpty())
+        return writeFile(pContent, pFilePath);
+
+    const QString blob = blobPath(QCryptographicHash::hash(pContent, QCryptographicHash::Sha1));
+    QFileInfo blobInfo(blob);
+    if (blobInfo.exists() && blobInfo.size() == pContent.size())
+    {
+        mStats.reused++;
+        mStats.bytesReused += pContent.size();
+    }
+    else if (!storeBlob(pContent, blob))
+    {
+        return writeFile(pContent, pFilePath);
+    }
+
+    if (createHardLink(blob, pFilePath))
+        return true;
+
+    // Typically a FAT/FUSE storage: no point in keeping blobs around
+    qDebug() << "Hardlinks not supported in" << QFileInfo(pFilePath).absolutePath() << "- writing copies";
+    mLinksSupported = false;
+    QFile::remove(blob);
+    return writeFile(pContent, pFilePath);
+}
+
+BlobStore::Stats BlobStore::takeStats()
+{
+    Stats stats = mStats;
+    mStats = Stats();
+    return stats;
+}
+
+qint64 BlobStore::prune()
+{
+    if (mPath.isEmpty())
+        return 0;
+
+    qint64 freedBytes = 0;
+    QDirIterator it(mPath, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QString blob = it.next();
+        if (linkCount(blob) != 1)
+            continue;
+
+        qint64 size = it.fileInfo().size();
+        if (QFile::remove(blob))
+            freedBytes += size;
+    }
+    return freedBytes;
+}
+
+void BlobStore::breakLink(const QString &pFilePath)
+{
+    if (linkCount(pFilePath) <= 1)
+        return;
+
+    // Removing the link leaves the blob and the other projects untouched
+    QFile::remove(pFilePath);
+}
+
+int BlobStore::linkCount(const QString &pFilePath)
+{
+#if defined(Q_OS_WIN)
+    HANDLE handle = CreateFileW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(pFilePath).utf16()),
+                                0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return 0;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    int count = GetFileInformationByHandle(handle, &info) ? int(info.nNumberOfLinks) : 0;
+    CloseHandle(handle);
+    return count;
+#else
+    struct stat info;
+    if (::stat(QFile::encodeName(pFilePath).constData(), &info) != 0)
+        return 0;
+    return int(info.st_nlink);
+#endif
+}
+
+QString BlobStore::blobPath(const QByteArray &pHash) const
+{
+    const QString hex = QString::fromLatin1(pHash.toHex());
+    return QString("%1/%2/%3").arg(mPath, hex.left(2), hex);
+}
+
+bool BlobStore::storeBlob(const QByteArray &pContent, const QString &pBlobPath)
+{
+    // Written aside then renamed: a blob is either complete or absent
+    QDir().mkpath(QFileInfo(pBlobPath).absolutePath());
+
+    const QString tempPath = pBlobPath + ".tmp";
+    QFile::remove(tempPath);
+    QFile::remove(pBlobPath); // truncated leftover
+    if (!writeFile(pContent, tempPath) || !QFile::rename(tempPath, pBlobPath))
+    {
+        qDebug() << "Could not store blob" << pBlobPath;
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    protectBlob(pBlobPath);
+    return true;
+}
+
+bool BlobStore::createHardLink(const QString &pTarget, const QString &pLinkPath)
+{
+#if defined(Q_OS_WIN)
+    return CreateHardLinkW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(pLinkPath).utf16()),
+                           reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(pTarget).utf16()),
+                           nullptr);
+#else
+    return ::link(QFile::encodeName(pTarget).constData(), QFile::encodeName(pLinkPath).constData()) == 0;
+#endif
+}
+
+bool BlobStore::writeFile(const QByteArray &pContent, const QString &pFilePath)
+{
+    QFile file(pFilePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Could not open " << pFilePath << "[WriteOnly]";
+        return false;
+    }
+    return file.write(pContent) == pContent.size();
+}
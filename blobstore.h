@@ -0,0 +1,53 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QByteArray>
+#include <QString>
+
+// ---------------------------------------------------------------
+// BlobStore
+// ---------------------------------------------------------------
+
+// Content-addressed store (<path>/<first 2 hex digits>/<sha1>) shared by all projects:
+// project files are hardlinks to their blob, so identical assets are written and stored once.
+// Blobs are read-only; anything writing a project file must call breakLink() first.
+// Falls back to plain copies where the file system has no hardlinks.
+// Not thread-safe: meant to be owned by the sync thread.
+class BlobStore
+{
+public:
+    struct Stats
+    {
+        int files = 0;
+        int reused = 0;
+        qint64 bytesReused = 0;
+    };
+
+    void setPath(const QString& pPath);
+
+    // Writes pContent at pFilePath, through the store when possible
+    bool materialize(const QByteArray& pContent, const QString& pFilePath);
+
+    // Stats since the last call
+    Stats takeStats();
+
+    // Removes the blobs no project links to anymore. Returns the bytes freed.
+    qint64 prune();
+
+    // Makes pFilePath a file of its own (removes it if it is a link to a blob), before it is written
+    static void breakLink(const QString& pFilePath);
+    static int linkCount(const QString& pFilePath);
+
+protected:
+    QString blobPath(const QByteArray& pHash) const;
+    bool storeBlob(const QByteArray& pContent, const QString& pBlobPath);
+    static bool createHardLink(const QString& pTarget, const QString& pLinkPath);
+    static bool writeFile(const QByteArray& pContent, const QString& pFilePath);
+
+private:
+    QString mPath;
+    bool mLinksSupported = true;
+    Stats mStats;
+};
+
+#endif // BLOBSTORE_H
@@ -0,0 +1,145 @@
+#include "componentwarmer.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QQmlEngine>
+
+#include "logging.h"
+
+namespace
+{
+const int kIdleDelay = 100;      // ms between two compilations, to leave frames to the document
+const int kMaxWarmedFiles = 100; // compiled components are kept in memory
+}
+
+inline QString normalizedFile(const QString& pFile)
+{
+    QString path = pFile;
+    int queryIndex = path.indexOf('?');
+    if (queryIndex >= 0)
+        path.truncate(queryIndex);
+    return QDir::cleanPath(path.remove("file:///"));
+}
+
+// ---------------------------------------------------------------
+// ComponentWarmer
+// ---------------------------------------------------------------
+
+ComponentWarmer::ComponentWarmer(QObject *parent)
+    : QObject(parent)
+{
+    mIdleTimer.setSingleShot(true);
+    mIdleTimer.setInterval(kIdleDelay);
+    connect(&mIdleTimer, &QTimer::timeout, this, &ComponentWarmer::compileNext);
+}
+
+void ComponentWarmer::setEngine(QQmlEngine *pEngine)
+{
+    invalidate();
+    mEngine = pEngine;
+}
+
+void ComponentWarmer::setUrlMapper(std::function<QUrl (QString)> pUrlMapper)
+{
+    mUrlMapper = pUrlMapper;
+}
+
+void ComponentWarmer::setEnabled(bool pEnabled)
+{
+    mEnabled = pEnabled;
+    if (!mEnabled)
+        invalidate();
+}
+
+void ComponentWarmer::warmUp(const QString &pProjectPath, const QString &pCurrentFile)
+{
+    if (!mEnabled || !mEngine || mStarted || pProjectPath.isEmpty())
+        return;
+    mStarted = true;
+
+    QString currentFile = normalizedFile(pCurrentFile);
+    QDirIterator it(normalizedFile(pProjectPath), { "*.qml" }, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext() && mQueue.size() < kMaxWarmedFiles)
+    {
+        QString file = QDir::cleanPath(it.next());
+        if (file != currentFile)
+            mQueue << file;
+    }
+
+    if (!mQueue.isEmpty())
+    {
+        qCDebug(lcApp) << "Warming up" << mQueue.size() << "documents";
+        mIdleTimer.start();
+    }
+}
+
+void ComponentWarmer::invalidate()
+{
+    mIdleTimer.stop();
+    mQueue.clear();
+    mStarted = false;
+    mGeneration++;
+
+    // Deleting the component cancels its loading
+    if (mCompiling)
+    {
+        disconnect(mCompiling, nullptr, this, nullptr);
+        mCompiling->deleteLater();
+    }
+    mCompiling = nullptr;
+    mCompilingFile.clear();
+
+    qDeleteAll(mWarmed);
+    mWarmed.clear();
+}
+
+QString ComponentWarmer::warmedSource(const QString &pFile) const
+{
+    QString file = normalizedFile(pFile);
+    if (!mWarmed.contains(file))
+        return QString();
+
+    return QUrl::fromLocalFile(file).toString() + "?=warm" + QString::number(mGeneration);
+}
+
+void ComponentWarmer::compileNext()
+{
+    if (mCompiling || mQueue.isEmpty())
+        return;
+
+    mCompilingFile = mQueue.takeFirst();
+    QString source = QUrl::fromLocalFile(mCompilingFile).toString() + "?=warm" + QString::number(mGeneration);
+
+    mCompiling = new QQmlComponent(mEngine, this);
+    connect(mCompiling, &QQmlComponent::statusChanged, this, &ComponentWarmer::onStatusChanged);
+    mCompiling->loadUrl(mUrlMapper ? mUrlMapper(source) : QUrl(source), QQmlComponent::Asynchronous);
+
+    // Already in the type cache
+    if (mCompiling && !mCompiling->isLoading())
+        onStatusChanged(mCompiling->status());
+}
+
+void ComponentWarmer::onStatusChanged(QQmlComponent::Status pStatus)
+{
+    if (!mCompiling || pStatus == QQmlComponent::Loading || pStatus == QQmlComponent::Null)
+        return;
+
+    if (pStatus == QQmlComponent::Ready)
+    {
+        mWarmed.insert(mCompilingFile, mCompiling);
+    }
+    else
+    {
+        // Not necessarily a document (e.g. a component needing properties): just not warmed
+        qCDebug(lcApp) << "Could not warm up" << mCompilingFile << mCompiling->errorString();
+        mCompiling->deleteLater();
+    }
+    mCompiling = nullptr;
+    mCompilingFile.clear();
+
+    if (mQueue.isEmpty())
+        qCDebug(lcApp) << "Warm-up done," << mWarmed.size() << "documents compiled";
+    else
+        mIdleTimer.start();
+}
@@ -0,0 +1,70 @@
+#ifndef COMPONENTWARMER_H
+#define COMPONENTWARMER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QQmlEngine;
+QT_END_NAMESPACE
+
+// ---------------------------------------------------------------
+// ComponentWarmer
+// ---------------------------------------------------------------
+
+// Compiles the other documents of the project in the background, one at a time, once the
+// current one is displayed. A warmed document keeps its compiled component: switching to it
+// loads the same source, straight from the engine's type cache.
+// Anything synced or edited afterwards invalidates the whole warm-up (dependencies may have changed).
+class ComponentWarmer: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ComponentWarmer(QObject* parent = nullptr);
+
+    void setEngine(QQmlEngine* pEngine);
+
+    // Source (as reloaded) -> URL loaded by the engine
+    void setUrlMapper(std::function<QUrl(QString)> pUrlMapper);
+
+    void setEnabled(bool pEnabled);
+
+    // Queues the .qml files of pProjectPath, except pCurrentFile. Once per invalidation.
+    void warmUp(const QString& pProjectPath, const QString& pCurrentFile);
+
+    // Stops the warm-up in progress and forgets the warmed documents
+    void invalidate();
+
+    // Source to load pFile with, to reuse its compiled component (empty if not warmed)
+    QString warmedSource(const QString& pFile) const;
+
+protected:
+    void compileNext();
+    void onStatusChanged(QQmlComponent::Status pStatus);
+
+private:
+    QQmlEngine* mEngine = nullptr;
+    std::function<QUrl(QString)> mUrlMapper;
+    bool mEnabled = true;
+
+    bool mStarted = false;
+    int mGeneration = 0;
+    QStringList mQueue;
+    QTimer mIdleTimer;
+
+    QString mCompilingFile;
+    QPointer<QQmlComponent> mCompiling;
+
+    // Files -> component compiled from warmedSource()
+    QHash<QString, QQmlComponent*> mWarmed;
+};
+
+#endif // COMPONENTWARMER_H
@@ -4,6 +4,10 @@
 #include <QQmlEngine>
 #include <QDebug>
 
+#include <algorithm>
+
+#include "logging.h"
+
 // ---------------------------------------------------------------
 // FsEntry
 // ---------------------------------------------------------------
@@ -23,30 +27,59 @@ FsEntry::FsEntry(const FsEntry &other)
     mChildren = other.mChildren;
 }
 
-FsEntry::FsEntry(const QFileInfo &fileInfo, FsEntry *parent)
-    : QObject(parent)
+FsEntry::FsEntry(const QFileInfo &fileInfo, FsEntry *parent, FsTreeSnapshot *snapshot)
+    : FsEntry(fileInfo.absoluteFilePath(), fileInfo.fileName(), fileInfo.isDir() || fileInfo.isSymLink(), parent, snapshot)
 {
     assert(fileInfo.exists());
+}
 
-    setPath(fileInfo.absoluteFilePath());
-    setName(fileInfo.fileName());
-    setExpandable(fileInfo.isDir() || fileInfo.isSymLink());
-    setExpanded(expandable()); // TODO: read from settings
+FsEntry::FsEntry(const QString &path, const QString &name, bool expandable, FsEntry *parent, FsTreeSnapshot *snapshot)
+    : QObject(parent)
+{
+    setPath(path);
+    setName(name);
+    setExpandable(expandable);
+    setExpanded(expandable); // TODO: read from settings
     setParent(parent);
 
 //    qDebug() << "Creating entry for " << path();
 
     if (this->expandable())
+        loadChildren(snapshot);
+}
+
+void FsEntry::loadChildren(FsTreeSnapshot *snapshot)
+{
+    // One stat per directory: its listing only changes with its mtime
+    qint64 lastModified = snapshot ? QFileInfo(path()).lastModified().toMSecsSinceEpoch() : 0;
+
+    QVector<FsTreeSnapshot::Child> children;
+    if (!snapshot || !snapshot->children(path(), lastModified, children))
     {
-        QDir dir(fileInfo.absoluteFilePath());
+        QDir dir(path());
         QFileInfoList subdirs = dir.entryInfoList({"*.qml"}, QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot); // no filter on dirs
         // TODO QDirIterator::subdirectories
 
+        children.reserve(subdirs.size());
         for (auto& subdir: subdirs)
         {
-            this->mChildren.append(new FsEntry(subdir, this));
+            FsTreeSnapshot::Child child;
+            child.name = subdir.fileName();
+            child.expandable = subdir.isDir() || subdir.isSymLink();
+            child.size = subdir.size();
+            child.lastModified = subdir.lastModified().toMSecsSinceEpoch();
+            children.append(child);
         }
     }
+
+    if (snapshot)
+        snapshot->record(path(), lastModified, children);
+
+    mChildren.reserve(children.size());
+    for (const FsTreeSnapshot::Child& child: children)
+    {
+        this->mChildren.append(new FsEntry(path() + "/" + child.name, child.name, child.expandable, this, snapshot));
+    }
 }
 
 int FsEntry::row() const
@@ -159,7 +192,7 @@ FsEntryModel::FsEntryModel(QObject *parent)
 
     auto handleFileSystemChange = [=]()
     {
-        qDebug() << "file system change";
+        qCDebug(lcFileTree) << "File system change";
         loadEntries();
         emit this->fileSystemChange();
 
@@ -250,6 +283,10 @@ int FsEntryModel::rowCount(const QModelIndex &parent) const
         parentItem = static_cast<FsEntry*>(parent.internalPointer());
     }
 
+    // No path yet
+    if (!parentItem)
+        return 0;
+
     return parentItem->children().size();
 }
 
@@ -322,6 +359,13 @@ void FsEntryModel::setPath(const QString &path)
         loadEntries();
 }
 
+void FsEntryModel::setSnapshotPath(const QString &pSnapshotPath)
+{
+    mSnapshotEnabled = !pSnapshotPath.isEmpty();
+    if (mSnapshotEnabled)
+        mSnapshot.open(pSnapshotPath);
+}
+
 bool FsEntryModel::containsDir(const QString &path)
 {
     if (path.isEmpty())
@@ -379,7 +423,13 @@ void FsEntryModel::_loadEntries()
     QFileInfo rootInfo(mPath);
     assert(rootInfo.exists());
 
-    rootItem = new FsEntry(rootInfo);
+    if (mSnapshotEnabled)
+        mSnapshot.beginRecording();
+
+    rootItem = new FsEntry(rootInfo, nullptr, mSnapshotEnabled ? &mSnapshot : nullptr);
+
+    if (mSnapshotEnabled)
+        mSnapshot.commitRecording();
     endResetModel();
 }
 
@@ -388,6 +438,18 @@ FsEntry *FsEntryModel::root() const
     return rootItem;
 }
 
+qint64 FsEntryModel::memoryUsage() const
+{
+    qint64 bytes = 0;
+    recursiveCallback(rootItem,
+    [&bytes](FsEntry* entry) {
+        bytes += sizeof(FsEntry)
+               + (entry->path().size() + entry->name().size()) * qint64(sizeof(QChar))
+               + entry->children().size() * qint64(sizeof(FsEntry*));
+    });
+    return bytes + mSnapshot.memoryUsage();
+}
+
 // ---------------------------------------------------------------
 // FsProxyModel
 // ---------------------------------------------------------------
@@ -438,6 +500,18 @@ void FsProxyModel::setPath(const QString &path)
     }
 }
 
+void FsProxyModel::setSnapshotPath(const QString &pSnapshotPath)
+{
+    auto fsModel = qobject_cast<FsEntryModel*>(sourceModel());
+    if (!fsModel)
+    {
+        fsModel = new FsEntryModel(this);
+        connect(fsModel, &FsEntryModel::fileSystemChange, this, &FsProxyModel::fileSystemChange);
+        setSourceModel(fsModel);
+    }
+    fsModel->setSnapshotPath(pSnapshotPath);
+}
+
 QString FsProxyModel::filterText() const
 {
     return m_filterText;
@@ -489,6 +563,17 @@ void FsProxyModel::collapseAll()
     fsModel->collapseAll();
 }
 
+qint64 FsProxyModel::memoryUsage() const
+{
+    auto fsModel = qobject_cast<FsEntryModel*>(sourceModel());
+    return fsModel ? fsModel->memoryUsage() : 0;
+}
+
+FsEntryModel *FsProxyModel::entryModel() const
+{
+    return qobject_cast<FsEntryModel*>(sourceModel());
+}
+
 bool FsProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
     const QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
@@ -504,3 +589,172 @@ bool FsProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_pa
 
     return fuzzymatch(entry->name(), m_filterText);
 }
+
+// ---------------------------------------------------------------
+// FsFlatModel
+// ---------------------------------------------------------------
+
+FsFlatModel::FsFlatModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void FsFlatModel::setSourceModel(FsEntryModel *pSourceModel)
+{
+    if (mSourceModel)
+        disconnect(mSourceModel, nullptr, this, nullptr);
+
+    mSourceModel = pSourceModel;
+
+    // The entries are recreated when the tree reloads
+    if (mSourceModel)
+    {
+        connect(mSourceModel, &FsEntryModel::modelAboutToBeReset, this, &FsFlatModel::beginResetModel);
+        connect(mSourceModel, &FsEntryModel::modelReset, this, [=]()
+        {
+            rebuild();
+            endResetModel();
+        });
+    }
+
+    beginResetModel();
+    rebuild();
+    endResetModel();
+}
+
+void FsFlatModel::toggleExpanded(int pRow)
+{
+    if (pRow < 0 || pRow >= mRows.size())
+        return;
+
+    setExpanded(pRow, !mRows.at(pRow).entry->expanded());
+}
+
+void FsFlatModel::setExpanded(int pRow, bool pExpanded)
+{
+    if (pRow < 0 || pRow >= mRows.size())
+        return;
+
+    const Row row = mRows.at(pRow);
+    if (!row.entry->expandable() || row.entry->expanded() == pExpanded)
+        return;
+
+    row.entry->setExpanded(pExpanded);
+    if (pExpanded)
+        mCollapsedPaths.remove(row.entry->path());
+    else
+        mCollapsedPaths.insert(row.entry->path());
+
+    if (pExpanded)
+    {
+        QVector<Row> descendants;
+        collectVisibleRows(row.entry, row.depth + 1, descendants);
+        if (!descendants.isEmpty())
+        {
+            beginInsertRows(QModelIndex(), pRow + 1, pRow + descendants.size());
+            mRows.insert(pRow + 1, descendants.size(), Row());
+            std::copy(descendants.cbegin(), descendants.cend(), mRows.begin() + pRow + 1);
+            endInsertRows();
+        }
+    }
+    else
+    {
+        // Descendants are the rows right after, deeper than the directory
+        int last = pRow;
+        while (last + 1 < mRows.size() && mRows.at(last + 1).depth > row.depth)
+            ++last;
+
+        if (last > pRow)
+        {
+            beginRemoveRows(QModelIndex(), pRow + 1, last);
+            mRows.remove(pRow + 1, last - pRow);
+            endRemoveRows();
+        }
+    }
+
+    QModelIndex changed = index(pRow);
+    emit dataChanged(changed, changed, { IsExpandedRole });
+}
+
+QHash<int, QByteArray> FsFlatModel::roleNames() const
+{
+    QHash<int, QByteArray> result;
+    result.insert(NameRole, "fsName");
+    result.insert(PathRole, "fsPath");
+    result.insert(DepthRole, "depth");
+    result.insert(IsExpandableRole, "isExpandable");
+    result.insert(IsExpandedRole, "isExpanded");
+    result.insert(IsTopLevelRole, "isTopLevel");
+    result.insert(EntryRole, "entry");
+    return result;
+}
+
+int FsFlatModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : mRows.size();
+}
+
+QVariant FsFlatModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mRows.size())
+        return QVariant();
+
+    const Row& row = mRows.at(index.row());
+    switch (role)
+    {
+    case NameRole:
+        return row.entry->name();
+    case PathRole:
+        return row.entry->path();
+    case DepthRole:
+        return row.depth;
+    case IsExpandableRole:
+        return row.entry->expandable();
+    case IsExpandedRole:
+        return row.entry->expanded();
+    case IsTopLevelRole:
+        return row.depth == 0;
+    case EntryRole:
+        QQmlEngine::setObjectOwnership(row.entry, QQmlEngine::CppOwnership);
+        return QVariant::fromValue(row.entry);
+    }
+    return QVariant();
+}
+
+void FsFlatModel::rebuild()
+{
+    mRows.clear();
+    if (!mSourceModel || !mSourceModel->root())
+        return;
+
+    // Restore the collapsed directories on the new entries
+    recursiveCallback(mSourceModel->root(),
+    [this](FsEntry* entry) {
+        if (entry->expandable())
+            entry->setExpanded(!mCollapsedPaths.contains(entry->path()));
+    });
+
+    collectVisibleRows(mSourceModel->root(), 0, mRows);
+}
+
+void FsFlatModel::collectVisibleRows(const FsEntry *pEntry, int pDepth, QVector<Row> &pRows) const
+{
+    for (FsEntry* child: pEntry->children())
+    {
+        if (!isVisible(child))
+            continue;
+
+        Row row;
+        row.entry = child;
+        row.depth = pDepth;
+        pRows.append(row);
+
+        if (child->expandable() && child->expanded())
+            collectVisibleRows(child, pDepth + 1, pRows);
+    }
+}
+
+bool FsFlatModel::isVisible(const FsEntry *pEntry)
+{
+    return !pEntry->expandable() || !pEntry->children().isEmpty();
+}
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QFileInfo>
+#include <QSet>
 #include <QVector>
 #include <QTimer>
 
@@ -11,6 +12,7 @@
 
 #include <QFileSystemWatcher>
 
+#include "fstreesnapshot.h"
 #include "macros.h"
 
 class FsProxyModel;
@@ -32,7 +34,8 @@ class FsEntry: public QObject
 public:
     FsEntry();
     FsEntry(const FsEntry& other);
-    FsEntry(const QFileInfo& fileInfo, FsEntry* parent = nullptr);
+    FsEntry(const QFileInfo& fileInfo, FsEntry* parent = nullptr, FsTreeSnapshot* snapshot = nullptr);
+    FsEntry(const QString& path, const QString& name, bool expandable, FsEntry* parent, FsTreeSnapshot* snapshot);
 
     virtual ~FsEntry(){}
 
@@ -44,6 +47,10 @@ public:
     Q_INVOKABLE int childrenCount();
     Q_INVOKABLE FsEntry* childAt(int index);
 
+protected:
+    // Lists the directory, or takes its listing from the snapshot if it did not change
+    void loadChildren(FsTreeSnapshot* snapshot);
+
 private:
     QVector<FsEntry*> mChildren;
 };
@@ -95,6 +102,9 @@ public:
     QString path() const;
     void setPath(const QString &path);
 
+    // Persist the tree between launches: call before setPath
+    void setSnapshotPath(const QString& pSnapshotPath);
+
     bool containsDir(const QString& path);
 
     void expandAll();
@@ -102,6 +112,9 @@ public:
 
     FsEntry* root() const;
 
+    // Approximate bytes held by the entry tree
+    qint64 memoryUsage() const;
+
 signals:
     void fileSystemChange();
 
@@ -114,6 +127,8 @@ private:
     QString mPath;
     QFileSystemWatcher mWatcher;
     QTimer mChangeTimer;
+    FsTreeSnapshot mSnapshot;
+    bool mSnapshotEnabled = false;
 };
 
 class FsProxyModel: public QSortFilterProxyModel
@@ -127,6 +142,7 @@ public:
 
     QString path() const;
     void setPath(const QString &path);
+    void setSnapshotPath(const QString& pSnapshotPath);
 
     QString filterText() const;
     void setFilterText(QString filterText);
@@ -138,6 +154,10 @@ public:
     void expandAll();
     void collapseAll();
 
+    qint64 memoryUsage() const;
+
+    FsEntryModel* entryModel() const;
+
 signals:
     void filterTextChanged(QString filterText);
     void fileSystemChange();
@@ -152,5 +172,60 @@ private:
 };
 
 
+// ---------------------------------------------------------------
+// FsFlatModel
+// ---------------------------------------------------------------
+
+// The visible rows of the tree as a flat list (entry + depth), for a recycling ListView:
+// only on-screen rows get a delegate. Expanding or collapsing a directory inserts or removes
+// its visible descendants, the rest of the list is untouched. Empty directories are hidden.
+class FsFlatModel: public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles
+    {
+        NameRole = Qt::UserRole + 1,
+        PathRole,
+        DepthRole,
+        IsExpandableRole,
+        IsExpandedRole,
+        IsTopLevelRole,
+        EntryRole
+    };
+    Q_ENUM(Roles)
+
+    explicit FsFlatModel(QObject* parent = nullptr);
+
+    void setSourceModel(FsEntryModel* pSourceModel);
+
+    Q_INVOKABLE void toggleExpanded(int pRow);
+    Q_INVOKABLE void setExpanded(int pRow, bool pExpanded);
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+
+protected:
+    struct Row
+    {
+        FsEntry* entry = nullptr;
+        int depth = 0;
+    };
+
+    void rebuild();
+
+    // Appends the visible rows under pEntry
+    void collectVisibleRows(const FsEntry* pEntry, int pDepth, QVector<Row>& pRows) const;
+    static bool isVisible(const FsEntry* pEntry);
+
+private:
+    FsEntryModel* mSourceModel = nullptr;
+    QVector<Row> mRows;
+
+    // Kept across reloads of the tree (entries are recreated)
+    QSet<QString> mCollapsedPaths;
+};
 
 #endif // FILESYSTEM_H
@@ -0,0 +1,187 @@
+#include "filewriter.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+
+#include "blobstore.h"
+#include "logging.h"
+
+FileWriteStats &FileWriteStats::operator+=(const FileWriteStats &other)
+{
+    written += other.written;
+    skipped += other.skipped;
+    bytesSaved += other.bytesSaved;
+    return *this;
+}
+
+// ---------------------------------------------------------------
+// BatchFileWriter
+// ---------------------------------------------------------------
+
+QByteArray BatchFileWriter::contentHash(const QByteArray &pContent)
+{
+    return QCryptographicHash::hash(pContent, QCryptographicHash::Sha1);
+}
+
+void BatchFileWriter::add(const QString &pFilePath, const QString &pContent)
+{
+    add(pFilePath, pContent.toUtf8());
+}
+
+void BatchFileWriter::add(const QString &pFilePath, const QByteArray &pUtf8Content)
+{
+    PendingFile file;
+    file.filePath = QString(pFilePath).replace("file:///", "");
+    file.content = pUtf8Content;
+
+    // Last one wins if the same file is added twice in a batch
+    auto it = mBatchIndex.constFind(file.filePath);
+    if (it != mBatchIndex.constEnd())
+    {
+        mBatch[it.value()].content = file.content;
+        return;
+    }
+    mBatchIndex.insert(file.filePath, mBatch.size());
+    mBatch.append(file);
+}
+
+FileWriteStats BatchFileWriter::flush()
+{
+    FileWriteStats stats;
+    if (mBatch.isEmpty())
+        return stats;
+
+    // Ensure target directories exist, once per batch
+    QSet<QString> directories;
+    for (const PendingFile& file: mBatch)
+        directories.insert(file.filePath.mid(0, file.filePath.lastIndexOf("/")));
+    for (const QString& directory: directories)
+        QDir().mkpath(directory);
+
+    // The cache is only read during the parallel pass
+    QtConcurrent::blockingMap(mBatch, [this](PendingFile& file) { writeIfChanged(file); });
+
+    for (const PendingFile& file: mBatch)
+    {
+        auto cached = mCache.find(file.filePath);
+        if (cached != mCache.end())
+        {
+            mCacheBytes -= cacheEntryBytes(cached.key(), *cached);
+            mCache.erase(cached);
+        }
+
+        if (file.failed)
+        {
+            qCWarning(lcSync) << QString("Unable to create file \"%1\"").arg(file.filePath);
+            continue;
+        }
+
+        mCache.insert(file.filePath, file.cacheEntry);
+        mCacheBytes += cacheEntryBytes(file.filePath, file.cacheEntry);
+        if (file.written)
+        {
+            stats.written++;
+        }
+        else
+        {
+            stats.skipped++;
+            stats.bytesSaved += file.content.size();
+        }
+    }
+    mBatch.clear();
+    mBatchIndex.clear();
+
+    return stats;
+}
+
+bool BatchFileWriter::pendingContent(const QString &pFilePath, QByteArray &pContent) const
+{
+    auto it = mBatchIndex.constFind(QString(pFilePath).replace("file:///", ""));
+    if (it == mBatchIndex.constEnd())
+        return false;
+
+    pContent = mBatch.at(it.value()).content;
+    return true;
+}
+
+QHash<QString, QByteArray> BatchFileWriter::pendingFiles() const
+{
+    QHash<QString, QByteArray> files;
+    files.reserve(mBatch.size());
+    for (const PendingFile& file: mBatch)
+        files.insert(file.filePath, file.content);
+    return files;
+}
+
+void BatchFileWriter::clearCache()
+{
+    mCache.clear();
+    mCacheBytes = 0;
+}
+
+qint64 BatchFileWriter::cacheBytes() const
+{
+    return mCacheBytes;
+}
+
+qint64 BatchFileWriter::cacheEntryBytes(const QString &pFilePath, const CacheEntry &pEntry)
+{
+    // Approximation: key + hash + entry, ignoring the hash table overhead
+    return pFilePath.size() * qint64(sizeof(QChar)) + pEntry.hash.size() + qint64(sizeof(CacheEntry));
+}
+
+void BatchFileWriter::writeIfChanged(PendingFile &pFile) const
+{
+    const QByteArray hash = contentHash(pFile.content);
+    QFileInfo info(pFile.filePath);
+
+    if (info.exists())
+    {
+        auto cached = mCache.constFind(pFile.filePath);
+        if (cached != mCache.constEnd())
+        {
+            // Known file, untouched since we wrote it: only the content hash matters
+            if (cached->size == info.size() && cached->lastModified == info.lastModified() && cached->hash == hash)
+            {
+                pFile.cacheEntry = *cached;
+                return;
+            }
+        }
+        else if (info.size() == pFile.content.size())
+        {
+            // Unknown file (e.g. from a previous run): compare with the bytes on disk
+            QFile file(pFile.filePath);
+            if (file.open(QIODevice::ReadOnly) && file.readAll() == pFile.content)
+            {
+                pFile.cacheEntry.size = info.size();
+                pFile.cacheEntry.lastModified = info.lastModified();
+                pFile.cacheEntry.hash = hash;
+                return;
+            }
+        }
+    }
+
+    // Files linked to the blob store are shared with other projects
+    BlobStore::breakLink(pFile.filePath);
+
+    // Binary: the bytes on disk are the bytes hashed and compared above, CRLF included
+    QFile file(pFile.filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        pFile.failed = true;
+        return;
+    }
+    file.write(pFile.content);
+    file.close();
+
+    info.refresh();
+    pFile.written = true;
+    pFile.cacheEntry.size = info.size();
+    pFile.cacheEntry.lastModified = info.lastModified();
+    pFile.cacheEntry.hash = hash;
+}
@@ -0,0 +1,72 @@
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+struct FileWriteStats
+{
+    int written = 0;
+    int skipped = 0;
+    qint64 bytesSaved = 0;
+
+    FileWriteStats& operator+=(const FileWriteStats& other);
+};
+
+// ---------------------------------------------------------------
+// BatchFileWriter
+// ---------------------------------------------------------------
+
+// Materializes a batch of text files: each directory is created once per batch,
+// files whose content is unchanged on disk are skipped and the others are written in parallel.
+// Not thread-safe: meant to be owned by the sync thread.
+class BatchFileWriter
+{
+public:
+    void add(const QString& pFilePath, const QString& pContent);
+    void add(const QString& pFilePath, const QByteArray& pUtf8Content);
+    FileWriteStats flush();
+
+    // Content added to the batch for this file, not written yet
+    bool pendingContent(const QString& pFilePath, QByteArray& pContent) const;
+
+    // File path -> content, for the whole batch
+    QHash<QString, QByteArray> pendingFiles() const;
+
+    void clearCache();
+    qint64 cacheBytes() const;
+
+    static QByteArray contentHash(const QByteArray& pContent);
+
+private:
+    struct CacheEntry
+    {
+        qint64 size = -1;
+        QDateTime lastModified;
+        QByteArray hash;
+    };
+
+    struct PendingFile
+    {
+        QString filePath;
+        QByteArray content;
+
+        // Results, filled in by the (parallel) write
+        bool written = false;
+        bool failed = false;
+        CacheEntry cacheEntry;
+    };
+
+    void writeIfChanged(PendingFile& pFile) const;
+    static qint64 cacheEntryBytes(const QString& pFilePath, const CacheEntry& pEntry);
+
+    QVector<PendingFile> mBatch;
+    QHash<QString, int> mBatchIndex;
+    QHash<QString, CacheEntry> mCache;
+    qint64 mCacheBytes = 0;
+};
+
+#endif // FILEWRITER_H
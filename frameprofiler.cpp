@@ -0,0 +1,267 @@
+#include "frameprofiler.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QUrl>
+
+#include <algorithm>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const int kDefaultPeriod = 2000;  // ms
+const int kMaxFrames = 10000;     // per period and timing
+
+// Upper bounds of the jank histogram buckets, in ms of frame time (60 Hz frames missed: 0, 1, 2, 5, more)
+const float kJankBounds[] = { 16.7f, 33.4f, 50.0f, 100.0f };
+const int kJankBucketCount = sizeof(kJankBounds) / sizeof(kJankBounds[0]) + 1;
+
+QVariantMap summary(QVector<float> pTimings)
+{
+    if (pTimings.isEmpty())
+        return QVariantMap { { "avg", 0.0 }, { "p95", 0.0 }, { "max", 0.0 } };
+
+    std::sort(pTimings.begin(), pTimings.end());
+    double sum = 0.0;
+    for (float timing: pTimings)
+        sum += timing;
+
+    int p95Index = qBound(0, int(0.95 * pTimings.size() + 0.5) - 1, pTimings.size() - 1);
+    return QVariantMap
+    {
+        { "avg", sum / pTimings.size() },
+        { "p95", double(pTimings.at(p95Index)) },
+        { "max", double(pTimings.last()) }
+    };
+}
+
+QJsonArray compact(const QVariantMap& pSummary)
+{
+    // [avg, p95, max], 0.1 ms is precise enough
+    QJsonArray values;
+    for (const char* key: { "avg", "p95", "max" })
+        values.append(qRound(pSummary.value(key).toDouble() * 10.0) / 10.0);
+    return values;
+}
+}
+
+// ---------------------------------------------------------------
+// FrameProfiler
+// ---------------------------------------------------------------
+
+FrameProfiler::FrameProfiler(QObject *parent)
+    : QObject(parent),
+      mFrameStart(-1)
+{
+    mClock.start();
+    mPeriodTimer.setInterval(kDefaultPeriod);
+    connect(&mPeriodTimer, &QTimer::timeout, this, &FrameProfiler::finishPeriod);
+}
+
+void FrameProfiler::setWindow(QQuickWindow *pWindow)
+{
+    disconnectWindow();
+    mWindow = pWindow;
+    if (mEnabled)
+        connectWindow();
+}
+
+void FrameProfiler::setPeriod(int pMilliseconds)
+{
+    mPeriodTimer.setInterval(qMax(100, pMilliseconds));
+}
+
+void FrameProfiler::setEnabled(bool pEnabled)
+{
+    if (mEnabled == pEnabled)
+        return;
+    mEnabled = pEnabled;
+
+    if (mEnabled)
+    {
+        connectWindow();
+        setDocument(mDocument);
+        mPeriodTimer.start();
+    }
+    else
+    {
+        mPeriodTimer.stop();
+        disconnectWindow();
+    }
+}
+
+bool FrameProfiler::isEnabled() const
+{
+    return mEnabled;
+}
+
+void FrameProfiler::setDocument(const QString &pDocument)
+{
+    QMutexLocker locker(&mMutex);
+    mDocument = pDocument;
+    for (QVector<float>& timings: mTimings)
+        timings.clear();
+    mPeriodStart = mClock.elapsed();
+    mPeriodCpuTime = processCpuTime();
+}
+
+QVariantMap FrameProfiler::statistics() const
+{
+    QMutexLocker locker(&mMutex);
+    return mStatistics;
+}
+
+QString FrameProfiler::telemetryMessage() const
+{
+    QVariantMap stats = statistics();
+
+    QJsonObject json
+    {
+        { "doc", stats.value("document").toString() },
+        { "t", stats.value("period").toInt() },
+        { "n", stats.value("frames").toInt() },
+        { "fps", qRound(stats.value("fps").toDouble() * 10.0) / 10.0 },
+        { "sync", compact(stats.value("sync").toMap()) },
+        { "render", compact(stats.value("render").toMap()) },
+        { "swap", compact(stats.value("swap").toMap()) },
+        { "frame", compact(stats.value("frame").toMap()) },
+        { "jank", QJsonArray::fromVariantList(stats.value("jank").toList()) },
+        { "rss", stats.value("rss").toLongLong() },
+        { "cpu", qRound(stats.value("cpu").toDouble() * 10.0) / 10.0 }
+    };
+
+    return "<messagetype>telemetry</messagetype><json>" +
+           QString::fromUtf8(QJsonDocument(json).toJson(QJsonDocument::Compact)) + "</json>";
+}
+
+qint64 FrameProfiler::processResidentBytes()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+qint64 FrameProfiler::processCpuTime()
+{
+#if defined(Q_OS_UNIX)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+    return -1;
+#endif
+}
+
+void FrameProfiler::connectWindow()
+{
+    if (!mWindow)
+        return;
+
+    // afterAnimating is emitted on the GUI thread, the others on the render thread
+    connect(mWindow, &QQuickWindow::afterAnimating, this, [=]()
+    {
+        mFrameStart.store(mClock.nsecsElapsed());
+    });
+    connect(mWindow, &QQuickWindow::beforeSynchronizing, this, [=]()
+    {
+        mSyncStart = mClock.nsecsElapsed();
+    }, Qt::DirectConnection);
+    connect(mWindow, &QQuickWindow::afterSynchronizing, this, [=]()
+    {
+        mSyncEnd = mClock.nsecsElapsed();
+    }, Qt::DirectConnection);
+    connect(mWindow, &QQuickWindow::beforeRendering, this, [=]()
+    {
+        mRenderStart = mClock.nsecsElapsed();
+    }, Qt::DirectConnection);
+    connect(mWindow, &QQuickWindow::afterRendering, this, [=]()
+    {
+        mRenderEnd = mClock.nsecsElapsed();
+    }, Qt::DirectConnection);
+    connect(mWindow, &QQuickWindow::frameSwapped, this, &FrameProfiler::onFrameSwapped, Qt::DirectConnection);
+}
+
+void FrameProfiler::disconnectWindow()
+{
+    if (mWindow)
+        disconnect(mWindow, nullptr, this, nullptr);
+    mFrameStart.store(-1);
+}
+
+void FrameProfiler::onFrameSwapped()
+{
+    qint64 now = mClock.nsecsElapsed();
+    qint64 frameStart = mFrameStart.fetchAndStoreRelaxed(-1);
+
+    QMutexLocker locker(&mMutex);
+    if (mTimings[Frame].size() >= kMaxFrames)
+        return;
+
+    mTimings[Sync].append((mSyncEnd - mSyncStart) / 1000000.0f);
+    mTimings[Render].append((mRenderEnd - mRenderStart) / 1000000.0f);
+    mTimings[Swap].append((now - mRenderEnd) / 1000000.0f);
+
+    // Frames triggered by the render thread alone (no animation step) have no start
+    if (frameStart >= 0)
+        mTimings[Frame].append((now - frameStart) / 1000000.0f);
+}
+
+void FrameProfiler::finishPeriod()
+{
+    qint64 now = mClock.elapsed();
+    qint64 cpuTime = processCpuTime();
+    qint64 rss = processResidentBytes();
+
+    QMutexLocker locker(&mMutex);
+    qint64 period = qMax(qint64(1), now - mPeriodStart);
+    int frames = mTimings[Swap].size();
+
+    QVariantList jank;
+    int buckets[kJankBucketCount] = {};
+    for (float frameTime: mTimings[Frame])
+        buckets[std::upper_bound(std::begin(kJankBounds), std::end(kJankBounds), frameTime) - std::begin(kJankBounds)]++;
+    for (int bucket: buckets)
+        jank.append(bucket);
+
+    mStatistics = QVariantMap
+    {
+        { "document", QFileInfo(QUrl(mDocument).path()).fileName() },
+        { "period", period },
+        { "frames", frames },
+        { "fps", frames * 1000.0 / period },
+        { "sync", summary(mTimings[Sync]) },
+        { "render", summary(mTimings[Render]) },
+        { "swap", summary(mTimings[Swap]) },
+        { "frame", summary(mTimings[Frame]) },
+        { "jank", jank },
+        { "rss", rss },
+        { "cpu", cpuTime < 0 || mPeriodCpuTime < 0 ? -1.0 : (cpuTime - mPeriodCpuTime) / (period * 10.0) } // %
+    };
+
+    for (QVector<float>& timings: mTimings)
+        timings.clear();
+    mPeriodStart = now;
+    mPeriodCpuTime = cpuTime;
+    locker.unlock();
+
+    emit periodFinished();
+}
@@ -0,0 +1,97 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QQuickWindow;
+QT_END_NAMESPACE
+
+// ---------------------------------------------------------------
+// FrameProfiler
+// ---------------------------------------------------------------
+
+// Times each frame of a window (sync, render and swap on the render thread, and the whole frame
+// from animation to swap) and sums them up per period, with a jank histogram and the process
+// memory and CPU usage. Frames are only rendered on change: idle time does not count.
+class FrameProfiler: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameProfiler(QObject* parent = nullptr);
+
+    void setWindow(QQuickWindow* pWindow);
+    void setPeriod(int pMilliseconds);
+
+    // Connects to the window and starts the periods
+    void setEnabled(bool pEnabled);
+    bool isEnabled() const;
+
+    // Starts a new period for this document
+    void setDocument(const QString& pDocument);
+
+    // Last complete period: { document, period, frames, fps, sync, render, swap, frame, jank, rss, cpu }
+    // (sync/render/swap/frame are { avg, p95, max } in ms)
+    QVariantMap statistics() const;
+
+    // The same, compact, as sent to the server
+    QString telemetryMessage() const;
+
+    // Resident set size of the whole process, -1 where unavailable
+    static qint64 processResidentBytes();
+
+    // User + system time of the process, -1 where unavailable
+    static qint64 processCpuTime(); // µs
+
+signals:
+    void periodFinished();
+
+protected:
+    void connectWindow();
+    void disconnectWindow();
+    void finishPeriod();
+
+    // Render thread
+    void onFrameSwapped();
+
+private:
+    enum Timing
+    {
+        Sync = 0,
+        Render,
+        Swap,
+        Frame,
+        TimingCount
+    };
+
+    QPointer<QQuickWindow> mWindow;
+    bool mEnabled = false;
+    QTimer mPeriodTimer;
+    QElapsedTimer mClock;
+
+    // Frame in progress, ns on mClock. The frame start is set on the GUI thread.
+    QAtomicInteger<qint64> mFrameStart;
+    qint64 mSyncStart = 0;
+    qint64 mSyncEnd = 0;
+    qint64 mRenderStart = 0;
+    qint64 mRenderEnd = 0;
+
+    // Period in progress, filled from the render thread
+    mutable QMutex mMutex;
+    QVector<float> mTimings[TimingCount]; // ms
+    QString mDocument;
+    qint64 mPeriodStart = 0;
+    qint64 mPeriodCpuTime = 0;
+
+    QVariantMap mStatistics;
+};
+
+#endif // FRAMEPROFILER_H
@@ -0,0 +1,205 @@
+#include "fstreesnapshot.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
+
+namespace
+{
+const QByteArray kMagic = "QPFSNAP1";
+const int kDirCountOffset = 8 + 8; // after the magic and the creation time
+
+// Directories modified this close to the snapshot may have changed again within the mtime
+// resolution (1-2 s on FAT): they are always listed again
+const qint64 kMtimeResolution = 2000; // ms
+
+enum ChildFlags : quint8
+{
+    Expandable = 0x1
+};
+}
+
+// ---------------------------------------------------------------
+// FsTreeSnapshot
+// ---------------------------------------------------------------
+
+FsTreeSnapshot::~FsTreeSnapshot()
+{
+    mSaving.waitForFinished();
+    close();
+}
+
+void FsTreeSnapshot::open(const QString &pFilePath)
+{
+    close();
+    mFilePath = pFilePath;
+
+    mFile.setFileName(mFilePath);
+    if (!mFile.open(QIODevice::ReadOnly) || mFile.size() < kDirCountOffset + 4)
+    {
+        mFile.close();
+        return;
+    }
+
+    mMapping = mFile.map(0, mFile.size());
+    if (!mMapping)
+    {
+        mFile.close();
+        return;
+    }
+
+    index(QByteArray::fromRawData(reinterpret_cast<const char*>(mMapping), int(mFile.size())));
+}
+
+bool FsTreeSnapshot::isOpen() const
+{
+    return !mDirs.isEmpty();
+}
+
+bool FsTreeSnapshot::children(const QString &pDirPath, qint64 pLastModified, QVector<Child> &pChildren) const
+{
+    auto it = mDirs.constFind(pDirPath);
+    if (it == mDirs.constEnd() || it->lastModified != pLastModified ||
+        pLastModified >= mCreatedAt - kMtimeResolution)
+    {
+        return false;
+    }
+
+    QDataStream stream(mData);
+    stream.device()->seek(it->childrenOffset);
+
+    pChildren.clear();
+    pChildren.reserve(int(it->childCount));
+    for (quint32 i = 0; i < it->childCount; ++i)
+    {
+        QByteArray name;
+        quint8 flags = 0;
+        Child child;
+        stream >> name >> flags >> child.size >> child.lastModified;
+
+        child.name = QString::fromUtf8(name);
+        child.expandable = flags & Expandable;
+        pChildren.append(child);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+void FsTreeSnapshot::beginRecording()
+{
+    mRecording.clear();
+    mRecordedDirs = 0;
+
+    QDataStream stream(&mRecording, QIODevice::WriteOnly);
+    stream.writeRawData(kMagic.constData(), kMagic.size());
+    stream << qint64(QDateTime::currentMSecsSinceEpoch()) << quint32(0); // dir count, set on commit
+}
+
+void FsTreeSnapshot::record(const QString &pDirPath, qint64 pLastModified, const QVector<Child> &pChildren)
+{
+    if (mRecording.isEmpty())
+        return;
+
+    QByteArray block;
+    QDataStream blockStream(&block, QIODevice::WriteOnly);
+    for (const Child& child: pChildren)
+    {
+        blockStream << child.name.toUtf8()
+                    << quint8(child.expandable ? Expandable : 0)
+                    << child.size
+                    << child.lastModified;
+    }
+
+    QDataStream stream(&mRecording, QIODevice::WriteOnly | QIODevice::Append);
+    stream << pDirPath.toUtf8() << pLastModified << quint32(pChildren.size()) << quint32(block.size());
+    stream.writeRawData(block.constData(), block.size());
+    mRecordedDirs++;
+}
+
+void FsTreeSnapshot::commitRecording()
+{
+    if (mRecording.isEmpty())
+        return;
+
+    qToBigEndian(quint32(mRecordedDirs), reinterpret_cast<uchar*>(mRecording.data() + kDirCountOffset));
+
+    // The recording replaces the mapping; the previous save must be done before the file is replaced again
+    close();
+    index(mRecording);
+    mRecording.clear();
+
+    mSaving.waitForFinished();
+    const QString filePath = mFilePath;
+    const QByteArray data = mData;
+    if (filePath.isEmpty())
+        return;
+
+    mSaving = QtConcurrent::run([filePath, data]()
+    {
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+            qDebug() << "Could not save the file tree snapshot" << filePath;
+    });
+}
+
+qint64 FsTreeSnapshot::memoryUsage() const
+{
+    // The mapping is backed by the file: only the index and a recording cost memory
+    qint64 bytes = mRecording.size() + (mMapping ? 0 : mData.size());
+    for (auto it = mDirs.constBegin(); it != mDirs.constEnd(); ++it)
+        bytes += it.key().size() * qint64(sizeof(QChar)) + qint64(sizeof(DirRecord));
+    return bytes;
+}
+
+void FsTreeSnapshot::index(const QByteArray &pData)
+{
+    mData = pData;
+    mDirs.clear();
+
+    QDataStream stream(mData);
+    QByteArray magic(kMagic.size(), Qt::Uninitialized);
+    quint32 dirCount = 0;
+    if (stream.readRawData(magic.data(), magic.size()) != magic.size() || magic != kMagic)
+    {
+        qDebug() << "Not a file tree snapshot:" << mFilePath;
+        mData.clear();
+        return;
+    }
+    stream >> mCreatedAt >> dirCount;
+
+    mDirs.reserve(int(dirCount));
+    for (quint32 i = 0; i < dirCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QByteArray path;
+        DirRecord dir;
+        quint32 blockSize = 0;
+        stream >> path >> dir.lastModified >> dir.childCount >> blockSize;
+
+        // Children are only decoded on lookup
+        dir.childrenOffset = int(stream.device()->pos());
+        if (stream.skipRawData(int(blockSize)) != int(blockSize))
+            break;
+        mDirs.insert(QString::fromUtf8(path), dir);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        qDebug() << "Truncated file tree snapshot, ignored:" << mFilePath;
+        mDirs.clear();
+    }
+}
+
+void FsTreeSnapshot::close()
+{
+    mDirs.clear();
+    mData.clear();
+
+    if (mMapping)
+    {
+        mFile.unmap(mMapping);
+        mMapping = nullptr;
+    }
+    mFile.close();
+}
@@ -0,0 +1,74 @@
+#ifndef FSTREESNAPSHOT_H
+#define FSTREESNAPSHOT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// ---------------------------------------------------------------
+// FsTreeSnapshot
+// ---------------------------------------------------------------
+
+// Compact binary copy of a directory tree (names, types, sizes, mtimes), saved between launches.
+// When the tree is rebuilt, the listing of a directory is taken from the snapshot as long as the
+// directory mtime did not change: only modified directories are listed again.
+// The file is memory-mapped and a directory is only decoded when it is looked up.
+class FsTreeSnapshot
+{
+public:
+    struct Child
+    {
+        QString name;
+        bool expandable = false; // directory or symlink
+        qint64 size = 0;
+        qint64 lastModified = 0; // ms since epoch
+    };
+
+    ~FsTreeSnapshot();
+
+    // Maps the snapshot saved at pFilePath, if any
+    void open(const QString& pFilePath);
+    bool isOpen() const;
+
+    // Listing of pDirPath if its mtime is still pLastModified
+    bool children(const QString& pDirPath, qint64 pLastModified, QVector<Child>& pChildren) const;
+
+    // Building the next snapshot, while the tree is loaded
+    void beginRecording();
+    void record(const QString& pDirPath, qint64 pLastModified, const QVector<Child>& pChildren);
+
+    // Replaces the snapshot with the recording and saves it in the background
+    void commitRecording();
+
+    qint64 memoryUsage() const;
+
+protected:
+    void index(const QByteArray& pData);
+    void close();
+
+private:
+    struct DirRecord
+    {
+        qint64 lastModified = 0;
+        quint32 childCount = 0;
+        int childrenOffset = 0;
+    };
+
+    QString mFilePath;
+    QFile mFile;
+    uchar* mMapping = nullptr;
+
+    // Either the mapping or the last recording
+    QByteArray mData;
+    qint64 mCreatedAt = 0;
+    QHash<QString, DirRecord> mDirs;
+
+    QByteArray mRecording;
+    int mRecordedDirs = 0;
+    QFuture<void> mSaving;
+};
+
+#endif // FSTREESNAPSHOT_H
@@ -0,0 +1,181 @@
+#include "latencytracer.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+namespace
+{
+const int kMaxSamples = 1000;          // per stage
+const int kMaxOpenTraces = 1000;
+const qint64 kStaleTrace = 30000000000LL; // ns
+
+double percentile(const QVector<qint64>& pSortedSamples, double pPercentile)
+{
+    if (pSortedSamples.isEmpty())
+        return 0.0;
+
+    int index = qBound(0, int(pPercentile * pSortedSamples.size() + 0.5) - 1, pSortedSamples.size() - 1);
+    return pSortedSamples.at(index) / 1000000.0;
+}
+}
+
+// ---------------------------------------------------------------
+// LatencyTracer
+// ---------------------------------------------------------------
+
+LatencyTracer::LatencyTracer()
+{
+    mClock.start();
+    for (int stage = 0; stage < StageCount; ++stage)
+    {
+        mSamples[stage].reserve(kMaxSamples);
+        mNextSample[stage] = 0;
+    }
+}
+
+quint64 LatencyTracer::beginTrace()
+{
+    Trace trace;
+    trace.timestamps[Received] = mClock.nsecsElapsed();
+    for (int stage = Parsed; stage < StageCount; ++stage)
+        trace.timestamps[stage] = -1;
+
+    QMutexLocker locker(&mMutex);
+
+    // Traces that never completed (e.g. lost reload) must not accumulate
+    if (mOpenTraces.size() > kMaxOpenTraces)
+    {
+        for (auto it = mOpenTraces.begin(); it != mOpenTraces.end();)
+        {
+            if (trace.timestamps[Received] - it->timestamps[Received] > kStaleTrace)
+                it = mOpenTraces.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    quint64 traceId = mNextTraceId++;
+    mOpenTraces.insert(traceId, trace);
+    return traceId;
+}
+
+void LatencyTracer::mark(quint64 pTraceId, Stage pStage)
+{
+    qint64 now = mClock.nsecsElapsed();
+
+    QMutexLocker locker(&mMutex);
+    auto it = mOpenTraces.find(pTraceId);
+    if (it != mOpenTraces.end())
+        it->timestamps[pStage] = now;
+}
+
+void LatencyTracer::finishTrace(quint64 pTraceId)
+{
+    QMutexLocker locker(&mMutex);
+    auto it = mOpenTraces.find(pTraceId);
+    if (it == mOpenTraces.end())
+        return;
+
+    complete(*it);
+    mOpenTraces.erase(it);
+}
+
+void LatencyTracer::markPending(Stage pStage)
+{
+    if (pStage == FrameSwapped && !isAwaitingFrame())
+        return;
+
+    qint64 now = mClock.nsecsElapsed();
+    bool awaitingFrame = false;
+
+    QMutexLocker locker(&mMutex);
+    for (auto it = mOpenTraces.begin(); it != mOpenTraces.end();)
+    {
+        Trace& trace = *it;
+        if (trace.timestamps[pStage] < 0 && trace.timestamps[pStage - 1] >= 0)
+        {
+            trace.timestamps[pStage] = now;
+            if (pStage == FrameSwapped)
+            {
+                complete(trace);
+                it = mOpenTraces.erase(it);
+                continue;
+            }
+        }
+        awaitingFrame |= trace.timestamps[LoaderReady] >= 0;
+        ++it;
+    }
+    mAwaitingFrame.storeRelease(awaitingFrame ? 1 : 0);
+}
+
+bool LatencyTracer::isAwaitingFrame() const
+{
+    return mAwaitingFrame.loadAcquire() != 0;
+}
+
+int LatencyTracer::openTraceCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mOpenTraces.size();
+}
+
+void LatencyTracer::complete(const Trace &pTrace)
+{
+    for (int stage = Parsed; stage < StageCount; ++stage)
+    {
+        if (pTrace.timestamps[stage] < 0)
+            continue;
+
+        qint64 sample = pTrace.timestamps[stage] - pTrace.timestamps[Received];
+        if (mSamples[stage].size() < kMaxSamples)
+            mSamples[stage].append(sample);
+        else
+            mSamples[stage][mNextSample[stage]] = sample;
+        mNextSample[stage] = (mNextSample[stage] + 1) % kMaxSamples;
+    }
+}
+
+QVariantMap LatencyTracer::statistics() const
+{
+    QVariantMap result;
+
+    QMutexLocker locker(&mMutex);
+    for (int stage = Parsed; stage < StageCount; ++stage)
+    {
+        QVector<qint64> samples = mSamples[stage];
+        std::sort(samples.begin(), samples.end());
+
+        result.insert(stageName(Stage(stage)), QVariantMap
+        {
+            { "count", samples.size() },
+            { "p50", percentile(samples, 0.50) },
+            { "p90", percentile(samples, 0.90) },
+            { "p99", percentile(samples, 0.99) },
+            { "max", percentile(samples, 1.0) }
+        });
+    }
+    return result;
+}
+
+QByteArray LatencyTracer::toJson() const
+{
+    QJsonObject root;
+    root.insert("unit", "ms since websocket receive");
+    root.insert("stages", QJsonObject::fromVariantMap(statistics()));
+    return QJsonDocument(root).toJson();
+}
+
+QString LatencyTracer::stageName(Stage pStage)
+{
+    switch (pStage)
+    {
+    case Received:     return "received";
+    case Parsed:       return "parsed";
+    case Written:      return "written";
+    case LoaderReady:  return "loaderReady";
+    case FrameSwapped: return "frameSwapped";
+    default:           return QString();
+    }
+}
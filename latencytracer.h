@@ -0,0 +1,69 @@
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QVariantMap>
+#include <QVector>
+
+// ---------------------------------------------------------------
+// LatencyTracer
+// ---------------------------------------------------------------
+
+// Follows each server message from websocket receive to the first frame showing it.
+// Thread-safe: marks come from the GUI, sync and render threads.
+class LatencyTracer
+{
+public:
+    enum Stage
+    {
+        Received = 0,
+        Parsed,
+        Written,
+        LoaderReady,
+        FrameSwapped,
+        StageCount
+    };
+
+    LatencyTracer();
+
+    quint64 beginTrace();
+    void mark(quint64 pTraceId, Stage pStage);
+
+    // Ends a trace that will not lead to a reload (data message, file not displayed...)
+    void finishTrace(quint64 pTraceId);
+
+    // Marks every open trace waiting for this stage
+    void markPending(Stage pStage);
+    bool isAwaitingFrame() const;
+
+    // Traces neither displayed nor finished yet
+    int openTraceCount() const;
+
+    // Per stage percentiles, in ms since websocket receive
+    QVariantMap statistics() const;
+    QByteArray toJson() const;
+
+    static QString stageName(Stage pStage);
+
+private:
+    struct Trace
+    {
+        qint64 timestamps[StageCount];
+    };
+
+    void complete(const Trace& pTrace);
+
+    QElapsedTimer mClock;
+
+    mutable QMutex mMutex;
+    quint64 mNextTraceId = 1;
+    QHash<quint64, Trace> mOpenTraces;
+    QVector<qint64> mSamples[StageCount]; // ns since receive, bounded ring
+    int mNextSample[StageCount];
+    QAtomicInt mAwaitingFrame;
+};
+
+#endif // LATENCYTRACER_H
@@ -0,0 +1,131 @@
+#include "logging.h"
+
+#include <QDateTime>
+
+#include <atomic>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(lcSync, "qmlplayground.sync", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcApp, "qmlplayground.app", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcFileTree, "qmlplayground.filetree", QtInfoMsg)
+
+namespace
+{
+const char kCategoryPrefix[] = "qmlplayground.";
+
+QtMessageHandler gPreviousHandler = nullptr;
+bool gEchoDebug = true;
+
+// Copies at most pSize - 1 bytes, without splitting a UTF-8 sequence
+int copyUtf8(char* pDestination, int pSize, const char* pSource, int pLength)
+{
+    int length = qMin(pLength, pSize - 1);
+    if (length < pLength)
+    {
+        while (length > 0 && (uchar(pSource[length]) & 0xC0) == 0x80)
+            length--;
+    }
+    std::memcpy(pDestination, pSource, size_t(length));
+    pDestination[length] = '\0';
+    return length;
+}
+
+char typeLetter(int pType)
+{
+    switch (pType)
+    {
+    case QtDebugMsg:    return 'D';
+    case QtInfoMsg:     return 'I';
+    case QtWarningMsg:  return 'W';
+    case QtCriticalMsg: return 'C';
+    case QtFatalMsg:    return 'F';
+    default:            return '?';
+    }
+}
+}
+
+// ---------------------------------------------------------------
+// LogRingBuffer
+// ---------------------------------------------------------------
+
+LogRingBuffer &LogRingBuffer::instance()
+{
+    static LogRingBuffer ringBuffer;
+    return ringBuffer;
+}
+
+void LogRingBuffer::install(bool pCaptureDebug, bool pEchoDebug)
+{
+    instance();
+    gEchoDebug = pEchoDebug;
+    if (pCaptureDebug)
+        QLoggingCategory::setFilterRules("qmlplayground.*.debug=true");
+
+    gPreviousHandler = qInstallMessageHandler(&LogRingBuffer::messageHandler);
+}
+
+void LogRingBuffer::append(QtMsgType pType, const char *pCategory, const QString &pMessage)
+{
+    quint64 index = mNextIndex.fetchAndAddRelaxed(1);
+    Slot& slot = mSlots[index % kSlotCount];
+
+    slot.sequence.store(2 * index + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    QByteArray text = pMessage.toUtf8();
+    const char* category = pCategory ? pCategory : "default";
+    slot.timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot.type = pType;
+    copyUtf8(slot.category, kCategorySize, category, int(std::strlen(category)));
+    slot.length = copyUtf8(slot.text, kTextSize, text.constData(), text.size());
+
+    slot.sequence.storeRelease(2 * index + 2);
+}
+
+QStringList LogRingBuffer::entries() const
+{
+    quint64 end = mNextIndex.loadAcquire();
+    quint64 begin = end > quint64(kSlotCount) ? end - kSlotCount : 0;
+
+    QStringList entries;
+    for (quint64 index = begin; index < end; ++index)
+    {
+        const Slot& slot = mSlots[index % kSlotCount];
+        quint64 sequence = slot.sequence.loadAcquire();
+
+        Slot copy;
+        copy.timestamp = slot.timestamp;
+        copy.type = slot.type;
+        copy.length = qBound(0, slot.length, kTextSize - 1);
+        std::memcpy(copy.category, slot.category, kCategorySize);
+        std::memcpy(copy.text, slot.text, size_t(copy.length));
+        copy.category[kCategorySize - 1] = '\0';
+
+        // Being written, or already reused by a later message
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence != 2 * index + 2 || slot.sequence.load() != sequence)
+            continue;
+
+        entries << QString("%1 %2 %3: %4")
+                   .arg(QDateTime::fromMSecsSinceEpoch(copy.timestamp).toString("hh:mm:ss.zzz"))
+                   .arg(typeLetter(copy.type))
+                   .arg(QString::fromUtf8(copy.category))
+                   .arg(QString::fromUtf8(copy.text, copy.length));
+    }
+    return entries;
+}
+
+void LogRingBuffer::messageHandler(QtMsgType pType, const QMessageLogContext &pContext, const QString &pMessage)
+{
+    instance().append(pType, pContext.category, pMessage);
+
+    // Captured debug output of our categories stays in memory: no logcat round-trip per message
+    if (pType == QtDebugMsg && !gEchoDebug && pContext.category &&
+        std::strncmp(pContext.category, kCategoryPrefix, sizeof(kCategoryPrefix) - 1) == 0)
+    {
+        return;
+    }
+
+    if (gPreviousHandler)
+        gPreviousHandler(pType, pContext, pMessage);
+}
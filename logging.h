@@ -0,0 +1,58 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QAtomicInteger>
+#include <QLoggingCategory>
+#include <QString>
+#include <QStringList>
+
+// Debug output of these categories is off unless enabled by the logging rules
+// (e.g. QT_LOGGING_RULES="qmlplayground.sync.debug=true"): a disabled qCDebug costs a flag check.
+Q_DECLARE_LOGGING_CATEGORY(lcSync)
+Q_DECLARE_LOGGING_CATEGORY(lcApp)
+Q_DECLARE_LOGGING_CATEGORY(lcFileTree)
+
+// ---------------------------------------------------------------
+// LogRingBuffer
+// ---------------------------------------------------------------
+
+// The last messages logged by the process, kept in memory to be dumped or sent on demand.
+// Writers never block: each message takes the next slot (long messages are truncated),
+// and readers skip the slots being written.
+class LogRingBuffer
+{
+public:
+    static LogRingBuffer& instance();
+
+    // Installs the message handler feeding the ring. With pCaptureDebug, debug messages of the
+    // qmlplayground categories are enabled but only kept in the ring (unless pEchoDebug).
+    static void install(bool pCaptureDebug, bool pEchoDebug);
+
+    void append(QtMsgType pType, const char* pCategory, const QString& pMessage);
+
+    // Oldest first, "hh:mm:ss.zzz D category: message"
+    QStringList entries() const;
+
+private:
+    static const int kSlotCount = 512;
+    static const int kCategorySize = 32;
+    static const int kTextSize = 256;
+
+    struct Slot
+    {
+        // 2 * index + 1 while the message of that index is written, 2 * index + 2 once done
+        QAtomicInteger<quint64> sequence;
+        qint64 timestamp = 0; // ms since epoch
+        int type = 0;
+        int length = 0;
+        char category[kCategorySize];
+        char text[kTextSize];
+    };
+
+    static void messageHandler(QtMsgType pType, const QMessageLogContext& pContext, const QString& pMessage);
+
+    Slot mSlots[kSlotCount];
+    QAtomicInteger<quint64> mNextIndex;
+};
+
+#endif // LOGGING_H
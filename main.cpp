@@ -1,11 +1,17 @@
+#include <QCommandLineParser>
+#include <QDir>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
 #include <QSettings>
 #include <QtWebView>
 
 #include "applicationcontrol.h"
 #include "filesystem.h"
+#include "logging.h"
+#include "renderworker.h"
+#include "startuptrace.h"
 
 #if defined(Q_OS_ANDROID)
 #include "Multicastlock.h"
@@ -13,34 +19,152 @@
 
 int main(int argc, char *argv[])
 {
+    StartupTrace startupTrace;
+    startupTrace.start();
+
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QCoreApplication::setOrganizationName("QmlPlayground");
     QCoreApplication::setOrganizationDomain("QmlPlayground.com");
     QCoreApplication::setApplicationName("QmlPlaygroundClient");
     QSettings::setDefaultFormat(QSettings::IniFormat);
 
+    // Before anything logs. Captured debug output of the hot paths is only kept in memory.
+    {
+        QSettings settings;
+        LogRingBuffer::install(settings.value("log/captureDebug", false).toBool(),
+                               settings.value("log/echoDebug", false).toBool() || qEnvironmentVariableIsSet("QT_LOGGING_RULES"));
+    }
+
+    // The platform plugin is chosen when the application is created
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--render-worker") == 0)
+            RenderWorker::prepareEnvironment();
+    }
+
     QGuiApplication app(argc, argv);
-    QtWebView::initialize();
+    startupTrace.mark("application");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption recordOption("record", "Record the incoming websocket traffic to <file>.", "file");
+    parser.addOption(recordOption);
+    QCommandLineOption replayOption("replay", "Replay a recorded session from <file> instead of connecting to a server.", "file");
+    parser.addOption(replayOption);
+    QCommandLineOption replaySpeedOption("replay-speed", "Replay speed factor, or \"max\" (default: 1).", "speed", "1");
+    parser.addOption(replaySpeedOption);
+    QCommandLineOption replayReportOption("replay-report", "Write the latency report to <file> and quit once the replay is over.", "file");
+    parser.addOption(replayReportOption);
+    QCommandLineOption renderWorkerOption("render-worker", "Headless mode: render each pushed document to a PNG in <dir>.", "dir");
+    parser.addOption(renderWorkerOption);
+    QCommandLineOption serverOption("server", "Server to follow in render-worker mode (default: first discovered).", "ip:port");
+    parser.addOption(serverOption);
+    QCommandLineOption followOption("follow", "Also follow <ip:port> in the background (repeatable).", "ip:port");
+    parser.addOption(followOption);
+    parser.process(app);
+
+    if (parser.isSet(renderWorkerOption))
+    {
+        // Settings and cache of their own: a worker must not take over the interactive client
+        const QString outputDir = QDir(parser.value(renderWorkerOption)).absolutePath();
+        QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, outputDir + "/settings");
+
+        ApplicationControl appControl(outputDir + "/cache");
+        RenderWorker renderWorker(&appControl, outputDir);
+        if (!renderWorker.start(parser.value(serverOption)))
+            return -1;
+        for (const QString& server: parser.values(followOption))
+            appControl.addSession(server);
+        return app.exec();
+    }
+
+    // On desktop, Qt WebEngine must be set up before the window: initialized at launch unless
+    // startup/lazyWebView is set. Native mobile web views can be initialized on demand.
+#if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
+    bool webViewInitialized = ApplicationControl::isWebViewRequired();
+#else
+    bool webViewInitialized = !QSettings().value("startup/lazyWebView", false).toBool() ||
+                              ApplicationControl::isWebViewRequired();
+#endif
+    if (webViewInitialized)
+    {
+        QtWebView::initialize();
+        startupTrace.mark("webview");
+    }
 
 #if defined(Q_OS_ANDROID)
     MulticastLock mcLock; // automatically calls acquire
 #endif
 
     QQmlApplicationEngine engine;
+    startupTrace.mark("engine creation");
 
     ApplicationControl appControl;
     appControl.setEngine(&engine);
+    appControl.setWebViewInitialized(webViewInitialized);
     engine.rootContext()->setContextProperty("appControl", &appControl);
+    startupTrace.mark("discovery bind");
 
     FsProxyModel fsModel;
+    fsModel.setSnapshotPath(QDir(appControl.projectsPath()).absoluteFilePath("../filetree.snapshot"));
     fsModel.setPath(appControl.projectsPath());
     engine.rootContext()->setContextProperty("fsModel", &fsModel);
+    appControl.setFileSystemModel(&fsModel);
+
+    // Visible rows only, for the drawer
+    FsFlatModel fsTreeModel;
+    fsTreeModel.setSourceModel(fsModel.entryModel());
+    engine.rootContext()->setContextProperty("fsTreeModel", &fsTreeModel);
+    startupTrace.mark("filesystem scan");
 
     qmlRegisterUncreatableType<FsEntry>("qmlplayground", 1, 0, "FsEntry", "for kicks");
 
     engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
     if (engine.rootObjects().isEmpty())
         return -1;
+    startupTrace.mark("main.qml compile");
+
+    QQuickWindow* window = qobject_cast<QQuickWindow*>(engine.rootObjects().first());
+    appControl.setWindow(window);
+    if (!parser.isSet(replayOption))
+        appControl.restoreLastProject();
+
+    // frameSwapped is emitted on the render thread: report from the main thread
+    QMetaObject::Connection firstFrameConnection;
+    firstFrameConnection = QObject::connect(window, &QQuickWindow::frameSwapped, &appControl, [&]()
+    {
+        // Later frames may already be queued
+        if (!firstFrameConnection)
+            return;
+        QObject::disconnect(firstFrameConnection);
+        firstFrameConnection = QMetaObject::Connection();
+        startupTrace.mark("first frame");
+        startupTrace.log();
+        appControl.setStartupTrace(startupTrace.toVariantMap());
+    }, Qt::QueuedConnection);
+
+    for (const QString& server: parser.values(followOption))
+        appControl.addSession(server);
+
+    if (parser.isSet(recordOption))
+        appControl.startRecording(parser.value(recordOption));
+
+    if (parser.isSet(replayOption))
+    {
+        QString speed = parser.value(replaySpeedOption);
+        if (!appControl.replaySession(parser.value(replayOption), speed == "max" ? 0.0 : speed.toDouble()))
+            return -1;
+
+        if (parser.isSet(replayReportOption))
+        {
+            // Once the last replayed message is displayed
+            QObject::connect(&appControl, &ApplicationControl::replayFinished, [&]()
+            {
+                appControl.dumpLatencyReport(parser.value(replayReportOption));
+                app.quit();
+            });
+        }
+    }
 
     return app.exec();
 }
@@ -1,11 +1,8 @@
 import QtQuick 2.9
 import QtQuick.Controls 2.12
 import QtQuick.Controls.Material 2.12
-import QtWebSockets 1.1
-import QtWebView 1.1
 
 import Qt.labs.settings 1.0
-import Qt.labs.folderlistmodel 2.12
 
 import qmlplayground 1.0
 
@@ -25,6 +22,8 @@ ApplicationWindow {
 
         property alias hostNameAddress: hostAddressTextField.text
         property alias toolbarmode: toolbar.manualMode
+        property alias showLatencyOverlay: latencyOverlayCheckBox.checked
+        property alias showFrameProfiler: frameProfilerCheckBox.checked
     }
 
     //    FolderListModel {
@@ -160,6 +159,11 @@ ApplicationWindow {
         //        source: appControl.currentFile.length == 0 ? "" :
         //                appControl.currentFile + "?=" + Date.now();
         //        asynchronous: true
+
+        onStatusChanged: {
+            if (status === Loader.Ready || status === Loader.Error)
+                appControl.documentLoaded()
+        }
     }
 
     Rectangle {
@@ -191,12 +195,43 @@ ApplicationWindow {
         //            sourceComponent: treeDelegate
         //        }
         ListView {
-            anchors.fill: parent
-            model: fsModel
+            anchors.top: parent.top
+            anchors.bottom: cachedProjectsComboBox.top
+            width: parent.width
+            clip: true
+            model: fsTreeModel
             //            delegate: ItemDelegate {
             //                text: "Hello"
             //            }
-            delegate: treeDelegate
+            delegate: treeRowDelegate
+        }
+
+        // Switch to a project kept on disk, without waiting for a push
+        ComboBox {
+            id: cachedProjectsComboBox
+            anchors.bottom: frameProfilerCheckBox.top
+            width: parent.width
+            visible: count > 0
+            height: visible ? implicitHeight : 0
+            model: appControl.cachedProjects
+            textRole: "name"
+            displayText: "Cached projects"
+            onActivated: appControl.openCachedProject(appControl.cachedProjects[index].name)
+        }
+
+        // Frame timings are also sent to the server while shown
+        CheckBox {
+            id: frameProfilerCheckBox
+            anchors.bottom: latencyOverlayCheckBox.top
+            width: parent.width
+            text: "Show frame profiler"
+        }
+
+        CheckBox {
+            id: latencyOverlayCheckBox
+            anchors.bottom: parent.bottom
+            width: parent.width
+            text: "Show latency overlay"
         }
 
         /*
@@ -234,6 +269,127 @@ ApplicationWindow {
         */
     }
 
+    Rectangle {
+        id: latencyOverlay
+        anchors.top: parent.top
+        anchors.right: parent.right
+        width: latencyLabel.implicitWidth + 10
+        height: latencyLabel.implicitHeight + 10
+        visible: latencyOverlayCheckBox.checked
+        color: Qt.rgba(0,0,0, 0.6)
+        z: 99
+
+        Label {
+            id: latencyLabel
+            anchors.centerIn: parent
+            color: "white"
+            font.family: "monospace"
+            font.pointSize: 8
+        }
+
+        Timer {
+            interval: 1000
+            repeat: true
+            running: latencyOverlay.visible
+            triggeredOnStart: true
+            onTriggered: latencyLabel.text = latencyText(appControl.latencyStatistics())
+        }
+
+        // Double-tap to dump the report next to the cache
+        MouseArea {
+            anchors.fill: parent
+            onDoubleClicked: appControl.dumpLatencyReport()
+        }
+
+        function latencyText(vStats)
+        {
+            var vLines = ["stage         p50    p90    p99  (ms)"]
+            var vStages = ["parsed", "written", "loaderReady", "frameSwapped"]
+            for (var i = 0; i < vStages.length; ++i)
+            {
+                var vStage = vStats[vStages[i]]
+                vLines.push("%1 %2 %3 %4"
+                            .arg(pad(vStages[i], -12))
+                            .arg(pad(vStage.p50.toFixed(1), 6))
+                            .arg(pad(vStage.p90.toFixed(1), 6))
+                            .arg(pad(vStage.p99.toFixed(1), 6)))
+            }
+            return vLines.join("\n")
+        }
+
+        // Negative width pads on the right
+        function pad(vText, vWidth)
+        {
+            var vSpaces = "            "
+            return vWidth < 0 ? (vText + vSpaces).substring(0, -vWidth) :
+                                (vSpaces + vText).slice(-vWidth)
+        }
+    }
+
+    Binding {
+        target: appControl
+        property: "frameProfilerEnabled"
+        value: frameProfilerCheckBox.checked
+    }
+
+    Rectangle {
+        id: frameProfilerOverlay
+        anchors.top: parent.top
+        anchors.left: parent.left
+        width: frameProfilerLabel.implicitWidth + 10
+        height: frameProfilerLabel.implicitHeight + 10
+        visible: frameProfilerCheckBox.checked
+        color: Qt.rgba(0,0,0, 0.6)
+        z: 99
+
+        Label {
+            id: frameProfilerLabel
+            anchors.centerIn: parent
+            color: "white"
+            font.family: "monospace"
+            font.pointSize: 8
+        }
+
+        Connections {
+            target: appControl
+            onFrameProfilerEnabledChanged: frameProfilerLabel.text = "Profiling..."
+        }
+
+        Timer {
+            interval: 1000
+            repeat: true
+            running: frameProfilerOverlay.visible
+            onTriggered: {
+                var vStats = appControl.frameStatistics()
+                if (vStats.frames !== undefined)
+                    frameProfilerLabel.text = frameProfilerOverlay.profilerText(vStats)
+            }
+        }
+
+        function profilerText(vStats)
+        {
+            var vLines = ["%1  %2 fps".arg(vStats.document).arg(vStats.fps.toFixed(1)),
+                          "timing     avg    p95    max  (ms)"]
+            var vTimings = ["sync", "render", "swap", "frame"]
+            for (var i = 0; i < vTimings.length; ++i)
+            {
+                var vTiming = vStats[vTimings[i]]
+                vLines.push("%1 %2 %3 %4"
+                            .arg(latencyOverlay.pad(vTimings[i], -8))
+                            .arg(latencyOverlay.pad(vTiming.avg.toFixed(1), 6))
+                            .arg(latencyOverlay.pad(vTiming.p95.toFixed(1), 6))
+                            .arg(latencyOverlay.pad(vTiming.max.toFixed(1), 6)))
+            }
+            vLines.push("jank  <17:%1 <33:%2 <50:%3 <100:%4 >100:%5"
+                        .arg(vStats.jank[0]).arg(vStats.jank[1]).arg(vStats.jank[2])
+                        .arg(vStats.jank[3]).arg(vStats.jank[4]))
+            vLines.push("rss %1 MB  cpu %2 %"
+                        .arg(vStats.rss < 0 ? "n/a" : (vStats.rss / (1024 * 1024)).toFixed(1))
+                        .arg(vStats.cpu < 0 ? "n/a" : vStats.cpu.toFixed(1)))
+            return vLines.join("\n")
+        }
+    }
+
     Rectangle {
         id: loadingOverlay
         anchors.fill: parent
@@ -316,12 +472,10 @@ ApplicationWindow {
             //            else
             //                contentLoader.source = appControl.currentFile + "?=" + Date.now()
         }
-        onCurrentFileChanged: {
-            if (appControl.currentFile.length > 0)
-                contentLoader.source = appControl.currentFile + "?=" + Date.now()
-            //            print("hella")
+        onReloadRequested: {
+            // Scheduled by appControl, at most once per frame
+            contentLoader.source = source
             //            renderQml(appControl.readFileContents(appControl.currentFile));
-            //            print("hello")
         }
         onJsonMessage: {
             //            print("heyo", message)
@@ -360,103 +514,57 @@ ApplicationWindow {
         property FsEntry rootItem: fsModel.root()
     }
 
+    // One row of the flattened tree: children are rows of their own, indented by depth
     Component {
-        id: treeDelegate
+        id: treeRowDelegate
 
         ItemDelegate {
-            id: itemDelegate
-
-            width: parent.width
-            height: visible ? expanded ? contentRow.height + childrenDelegate.height : contentRow.height :
-            0
-
-            property bool expanded: isValid && itemData.expanded
-            property var itemData: entry
-            property bool isValid: typeof(itemData) !== "undefined"
-            property bool isDir: isValid && itemData.expandable
-//            property bool isRoot: isValid && itemData.parent == internal.rootItem
-
-            visible: isValid && ((!isDir) || (itemData.childrenCount() > 0))
+            width: ListView.view.width
+            height: 40
+            leftPadding: 10 * depth
 
             onClicked: {
-                if (!isValid)
-                    return;
-
-                if (isDir)
-                    itemData.expanded = !itemData.expanded
+                if (isExpandable)
+                    fsTreeModel.toggleExpanded(index)
                 else
                 {
-                    appControl.currentFile = "file:///" + itemData.path
+                    appControl.currentFile = "file:///" + fsPath
                     drawer.close()
                 }
             }
 
             onPressAndHold: {
                 // Only for root folders
-//                if (isRoot)
-                if (isValid && itemData.parent == fsModel.root())
+                if (isTopLevel && isExpandable)
                 {
-                    deleteFolderPopup.entryToDelete = itemData.path
+                    deleteFolderPopup.entryToDelete = fsPath
                     deleteFolderPopup.open()
                 }
             }
 
             highlighted: {
-                if (!isValid)
-                    return false;
-
-                var vPath = "file:///" + itemData.path
-
+                var vPath = "file:///" + fsPath
                 return vPath === appControl.currentFile || vPath === appControl.currentFolder
             }
 
-            Row {
-                id: contentRow
-                anchors.top: parent.top
-                width: parent.width
-                height: 40
-
+            contentItem: Row {
                 Image {
                     height: parent.height * 0.8
                     anchors.verticalCenter: parent.verticalCenter
                     fillMode: Image.PreserveAspectFit
-                    source: isValid ? itemData.expandable && itemData.expanded ? "qrc:///img/folderOpen.svg" :
-                                                                                 itemData.expandable ? "qrc:///img/folder.svg" :
-                                                                                                       "qrc:///img/newFile.svg" : ""
+                    source: isExpandable && isExpanded ? "qrc:///img/folderOpen.svg" :
+                            isExpandable ? "qrc:///img/folder.svg" :
+                                           "qrc:///img/newFile.svg"
                 }
 
                 Label {
                     height: parent.height
-                    text: typeof(itemData) !== "undefined" ? "" + itemData.name : "no data"
+                    text: fsName
                     verticalAlignment: Label.AlignVCenter
-//                    font.bold: itemDelegate.isRoot
                 }
             }
-
-            ListView {
-                id: childrenDelegate
-                anchors.top: contentRow.bottom
-                anchors.left: parent.left
-                anchors.leftMargin: 10
-                width: parent.width
-                height: childrenRect.height
-
-                visible: parent.expanded
-                interactive: false
-
-                model: typeof(itemData) !== "undefined" ? itemData.childrenCount() : 0
-
-                delegate: Loader {
-                    width: parent.width
-                    height: item.height
-//                    asynchronous: true
-                    sourceComponent: treeDelegate
-
-                    onLoaded: item.itemData = itemData.childAt(index)
-                } // Loader
-            } // ListView
-        } // ItemDelegate
-    } // Component
+        }
+    }
 
     Popup {
         id: deleteFolderPopup
@@ -0,0 +1,283 @@
+#include "memoryfilestore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include <cstring>
+
+const QString MemoryFileStore::kScheme = QStringLiteral("qmlmem");
+
+// Components are files such as Button.qml; pragma Singleton ones must be declared as such
+inline QByteArray qmldirEntry(const QString& pFileName, const QByteArray& pContent)
+{
+    QFileInfo info(pFileName);
+    if (info.suffix() != "qml" || info.completeBaseName().isEmpty() || !info.completeBaseName().at(0).isUpper())
+        return QByteArray();
+
+    QByteArray entry = info.completeBaseName().toUtf8() + " 1.0 " + pFileName.toUtf8() + "\n";
+    return pContent.contains("pragma Singleton") ? "singleton " + entry : entry;
+}
+
+// ---------------------------------------------------------------
+// MemoryFileStore
+// ---------------------------------------------------------------
+
+void MemoryFileStore::insert(const QString &pFilePath, const QByteArray &pContent)
+{
+    QString filePath = cleanPath(pFilePath);
+
+    QWriteLocker locker(&mLock);
+    auto it = mFiles.find(filePath);
+    if (it != mFiles.end())
+    {
+        mBytes -= it->size();
+        *it = pContent;
+    }
+    else
+    {
+        mBytes += filePath.size() * qint64(sizeof(QChar));
+        mFiles.insert(filePath, pContent);
+    }
+    mBytes += pContent.size();
+}
+
+void MemoryFileStore::remove(const QString &pPath)
+{
+    QString path = cleanPath(pPath);
+    QString dirPath = path + "/";
+
+    QWriteLocker locker(&mLock);
+    for (auto it = mFiles.begin(); it != mFiles.end();)
+    {
+        if (it.key() == path || it.key().startsWith(dirPath))
+        {
+            mBytes -= it.key().size() * qint64(sizeof(QChar)) + it->size();
+            it = mFiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void MemoryFileStore::clear()
+{
+    QWriteLocker locker(&mLock);
+    mFiles.clear();
+    mBytes = 0;
+}
+
+bool MemoryFileStore::read(const QString &pFilePath, QByteArray &pContent) const
+{
+    QReadLocker locker(&mLock);
+    auto it = mFiles.constFind(cleanPath(pFilePath));
+    if (it == mFiles.constEnd())
+        return false;
+
+    pContent = *it;
+    return true;
+}
+
+QStringList MemoryFileStore::fileNames(const QString &pDirPath) const
+{
+    QString dirPath = cleanPath(pDirPath) + "/";
+
+    QStringList names;
+    QReadLocker locker(&mLock);
+    for (auto it = mFiles.constBegin(); it != mFiles.constEnd(); ++it)
+    {
+        if (it.key().startsWith(dirPath) && it.key().indexOf('/', dirPath.size()) < 0)
+            names << it.key().mid(dirPath.size());
+    }
+    return names;
+}
+
+qint64 MemoryFileStore::bytes() const
+{
+    QReadLocker locker(&mLock);
+    return mBytes;
+}
+
+QUrl MemoryFileStore::toUrl(const QString &pFileUrl)
+{
+    // The query is the cache-busting suffix of reloads
+    int queryIndex = pFileUrl.indexOf('?');
+    QString path = cleanPath(queryIndex < 0 ? pFileUrl : pFileUrl.left(queryIndex));
+
+    QUrl url;
+    url.setScheme(kScheme);
+    url.setPath(path.startsWith("/") ? path : "/" + path); // C:/ on Windows
+    if (queryIndex >= 0)
+        url.setQuery(pFileUrl.mid(queryIndex + 1));
+    return url;
+}
+
+QString MemoryFileStore::localPath(const QUrl &pUrl)
+{
+    QString path = pUrl.path();
+#if defined(Q_OS_WIN)
+    if (path.size() > 2 && path.at(2) == ':')
+        path.remove(0, 1);
+#endif
+    return cleanPath(path);
+}
+
+QString MemoryFileStore::localFilePath(const QString &pFileUrl)
+{
+    if (pFileUrl.startsWith(kScheme + ":"))
+        return localPath(QUrl(pFileUrl));
+    return QString(pFileUrl).replace("file:///", "");
+}
+
+QString MemoryFileStore::cleanPath(const QString &pPath)
+{
+    QString path = pPath;
+    path.remove("file:///");
+    return QDir::cleanPath(path);
+}
+
+// ---------------------------------------------------------------
+// MemoryNetworkReply
+// ---------------------------------------------------------------
+
+MemoryNetworkReply::MemoryNetworkReply(const QNetworkRequest &pRequest, const QByteArray &pContent, QObject *parent)
+    : QNetworkReply(parent),
+      mContent(pContent)
+{
+    setRequest(pRequest);
+    setUrl(pRequest.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    setHeader(QNetworkRequest::ContentLengthHeader, mContent.size());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    setFinished(true);
+
+    // Signals must come after the reply is handed over
+    QMetaObject::invokeMethod(this, [=]()
+    {
+        emit metaDataChanged();
+        emit downloadProgress(mContent.size(), mContent.size());
+        emit readyRead();
+        emit finished();
+    }, Qt::QueuedConnection);
+}
+
+MemoryNetworkReply::MemoryNetworkReply(const QNetworkRequest &pRequest, NetworkError pError, const QString &pErrorString, QObject *parent)
+    : QNetworkReply(parent)
+{
+    setRequest(pRequest);
+    setUrl(pRequest.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    setError(pError, pErrorString);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    setFinished(true);
+
+    QMetaObject::invokeMethod(this, [=]()
+    {
+        emit errorOccurred(pError);
+        emit finished();
+    }, Qt::QueuedConnection);
+}
+
+void MemoryNetworkReply::abort()
+{
+    mOffset = mContent.size();
+}
+
+qint64 MemoryNetworkReply::bytesAvailable() const
+{
+    return mContent.size() - mOffset + QNetworkReply::bytesAvailable();
+}
+
+bool MemoryNetworkReply::isSequential() const
+{
+    return true;
+}
+
+qint64 MemoryNetworkReply::readData(char *pData, qint64 pMaxSize)
+{
+    if (mOffset >= mContent.size())
+        return -1;
+
+    qint64 size = qMin(pMaxSize, mContent.size() - mOffset);
+    std::memcpy(pData, mContent.constData() + mOffset, size_t(size));
+    mOffset += size;
+    return size;
+}
+
+// ---------------------------------------------------------------
+// MemoryNetworkAccessManager
+// ---------------------------------------------------------------
+
+MemoryNetworkAccessManager::MemoryNetworkAccessManager(const MemoryFileStore *pStore, QObject *parent)
+    : QNetworkAccessManager(parent),
+      mStore(pStore)
+{
+}
+
+QNetworkReply *MemoryNetworkAccessManager::createRequest(Operation pOperation, const QNetworkRequest &pRequest, QIODevice *pOutgoingData)
+{
+    if (pRequest.url().scheme() != MemoryFileStore::kScheme)
+        return QNetworkAccessManager::createRequest(pOperation, pRequest, pOutgoingData);
+
+    if (pOperation != GetOperation)
+        return new MemoryNetworkReply(pRequest, QNetworkReply::ContentOperationNotPermittedError, "Read-only", this);
+
+    QString filePath = MemoryFileStore::localPath(pRequest.url());
+    QByteArray content;
+    if (readFile(filePath, content))
+        return new MemoryNetworkReply(pRequest, content, this);
+
+    if (QFileInfo(filePath).fileName() == "qmldir")
+        return new MemoryNetworkReply(pRequest, synthesizeQmldir(QFileInfo(filePath).path()), this);
+
+    return new MemoryNetworkReply(pRequest, QNetworkReply::ContentNotFoundError, "File not found: " + filePath, this);
+}
+
+bool MemoryNetworkAccessManager::readFile(const QString &pFilePath, QByteArray &pContent) const
+{
+    if (mStore->read(pFilePath, pContent))
+        return true;
+
+    // Assets, and files not pushed since launch
+    QFile file(pFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    pContent = file.readAll();
+    return true;
+}
+
+QByteArray MemoryNetworkAccessManager::synthesizeQmldir(const QString &pDirPath) const
+{
+    const QStringList storedNames = mStore->fileNames(pDirPath);
+    QSet<QString> fileNames(storedNames.begin(), storedNames.end());
+    for (const QString& fileName: QDir(pDirPath).entryList({ "*.qml" }, QDir::Files))
+        fileNames.insert(fileName);
+
+    QByteArray qmldir;
+    for (const QString& fileName: fileNames)
+    {
+        QByteArray content;
+        if (readFile(pDirPath + "/" + fileName, content))
+            qmldir += qmldirEntry(fileName, content);
+    }
+    return qmldir;
+}
+
+// ---------------------------------------------------------------
+// MemoryNetworkAccessManagerFactory
+// ---------------------------------------------------------------
+
+MemoryNetworkAccessManagerFactory::MemoryNetworkAccessManagerFactory(const MemoryFileStore *pStore)
+    : mStore(pStore)
+{
+}
+
+QNetworkAccessManager *MemoryNetworkAccessManagerFactory::create(QObject *parent)
+{
+    return new MemoryNetworkAccessManager(mStore, parent);
+}
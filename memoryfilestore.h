@@ -0,0 +1,121 @@
+#ifndef MEMORYFILESTORE_H
+#define MEMORYFILESTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QQmlNetworkAccessManagerFactory>
+#include <QReadWriteLock>
+#include <QString>
+#include <QUrl>
+
+// ---------------------------------------------------------------
+// MemoryFileStore
+// ---------------------------------------------------------------
+
+// Latest content of the project text files, kept in RAM and served to the QML engine under the
+// qmlmem:// scheme, so that a reload does not wait for the files to reach the disk.
+// Paths that are not in the store (assets, files edited locally) are read from the disk.
+// Thread-safe: filled by the sync thread, read by the QML loader threads.
+class MemoryFileStore
+{
+public:
+    static const QString kScheme;
+
+    void insert(const QString& pFilePath, const QByteArray& pContent);
+
+    // Removes a file, or every file under a directory
+    void remove(const QString& pPath);
+    void clear();
+
+    bool read(const QString& pFilePath, QByteArray& pContent) const;
+
+    // File names directly in pDirPath
+    QStringList fileNames(const QString& pDirPath) const;
+
+    qint64 bytes() const;
+
+    // file:///path/to/Main.qml?=123 <-> qmlmem:///path/to/Main.qml?=123
+    static QUrl toUrl(const QString& pFileUrl);
+    static QString localPath(const QUrl& pUrl);
+
+    // Disk path of a file:// or qmlmem:// URL, or of a plain path, for the file APIs exposed to QML
+    static QString localFilePath(const QString& pFileUrl);
+
+protected:
+    static QString cleanPath(const QString& pPath);
+
+private:
+    mutable QReadWriteLock mLock;
+    QHash<QString, QByteArray> mFiles;
+    qint64 mBytes = 0;
+};
+
+// ---------------------------------------------------------------
+// MemoryNetworkReply
+// ---------------------------------------------------------------
+
+// Reply with a content known up front, or an error
+class MemoryNetworkReply: public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    MemoryNetworkReply(const QNetworkRequest& pRequest, const QByteArray& pContent, QObject* parent = nullptr);
+    MemoryNetworkReply(const QNetworkRequest& pRequest, NetworkError pError, const QString& pErrorString, QObject* parent = nullptr);
+
+    void abort() override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override;
+
+protected:
+    qint64 readData(char* pData, qint64 pMaxSize) override;
+
+private:
+    QByteArray mContent;
+    qint64 mOffset = 0;
+};
+
+// ---------------------------------------------------------------
+// MemoryNetworkAccessManager
+// ---------------------------------------------------------------
+
+// Answers qmlmem:// requests from the store, then from the disk. A qmldir listing the
+// components of a directory is synthesized when the project has none: unlike local
+// directories, remote ones are only imported through their qmldir.
+class MemoryNetworkAccessManager: public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    MemoryNetworkAccessManager(const MemoryFileStore* pStore, QObject* parent = nullptr);
+
+protected:
+    QNetworkReply* createRequest(Operation pOperation, const QNetworkRequest& pRequest,
+                                 QIODevice* pOutgoingData = nullptr) override;
+
+    bool readFile(const QString& pFilePath, QByteArray& pContent) const;
+    QByteArray synthesizeQmldir(const QString& pDirPath) const;
+
+private:
+    const MemoryFileStore* mStore = nullptr;
+};
+
+// ---------------------------------------------------------------
+// MemoryNetworkAccessManagerFactory
+// ---------------------------------------------------------------
+
+class MemoryNetworkAccessManagerFactory: public QQmlNetworkAccessManagerFactory
+{
+public:
+    explicit MemoryNetworkAccessManagerFactory(const MemoryFileStore* pStore);
+
+    // Called from the engine threads
+    QNetworkAccessManager* create(QObject* parent) override;
+
+private:
+    const MemoryFileStore* mStore = nullptr;
+};
+
+#endif // MEMORYFILESTORE_H
@@ -0,0 +1,270 @@
+#include "projectcache.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QVector>
+
+#include <algorithm>
+
+// ---------------------------------------------------------------
+// ProjectCache
+// ---------------------------------------------------------------
+
+void ProjectCache::setPaths(const QString &pProjectsPath, const QString &pIndexPath)
+{
+    mProjectsPath = pProjectsPath;
+    mIndexPath = pIndexPath;
+    mLoaded = false;
+    mEntries.clear();
+}
+
+void ProjectCache::setBudget(qint64 pBytes)
+{
+    mBudget = pBytes;
+}
+
+bool ProjectCache::isUpToDate(const QString &pName, const QByteArray &pManifestHash)
+{
+    const Entry* cached = entry(pName);
+    return cached && !cached->manifestHash.isEmpty() && cached->manifestHash == pManifestHash &&
+           QFileInfo(projectPath(pName)).isDir();
+}
+
+const ProjectCache::Entry *ProjectCache::entry(const QString &pName)
+{
+    ensureLoaded();
+
+    auto it = mEntries.constFind(pName);
+    return it == mEntries.constEnd() ? nullptr : &it.value();
+}
+
+void ProjectCache::update(const Entry &pEntry)
+{
+    ensureLoaded();
+
+    Entry& cached = mEntries[pEntry.name];
+    cached = pEntry;
+    cached.size = directorySize(projectPath(pEntry.name));
+    cached.lastUsed = QDateTime::currentDateTimeUtc();
+    save();
+}
+
+void ProjectCache::touch(const QString &pName, const QString &pCurrentFile)
+{
+    ensureLoaded();
+
+    auto it = mEntries.find(pName);
+    if (it == mEntries.end())
+        return;
+
+    if (!pCurrentFile.isEmpty())
+        it->currentFile = pCurrentFile;
+    it->lastUsed = QDateTime::currentDateTimeUtc();
+    save();
+}
+
+void ProjectCache::invalidate(const QString &pName)
+{
+    ensureLoaded();
+
+    auto it = mEntries.find(pName);
+    if (it == mEntries.end() || it->manifestHash.isEmpty())
+        return;
+
+    it->manifestHash.clear();
+    save();
+}
+
+QStringList ProjectCache::evict(const QString &pKeep)
+{
+    ensureLoaded();
+
+    QStringList evicted;
+    if (mBudget <= 0)
+        return evicted;
+
+    qint64 totalSize = 0;
+    QVector<const Entry*> candidates;
+    for (const Entry& cached: mEntries)
+    {
+        totalSize += cached.size;
+        if (cached.name != pKeep)
+            candidates.append(&cached);
+    }
+    if (totalSize <= mBudget)
+        return evicted;
+
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+    {
+        return a->lastUsed < b->lastUsed;
+    });
+
+    for (const Entry* cached: candidates)
+    {
+        if (totalSize <= mBudget)
+            break;
+
+        if (!QDir(projectPath(cached->name)).removeRecursively())
+        {
+            qDebug() << "Could not evict project" << cached->name;
+            continue;
+        }
+        totalSize -= cached->size;
+        evicted << cached->name;
+    }
+
+    for (const QString& name: evicted)
+        mEntries.remove(name);
+    save();
+
+    qDebug() << "Evicted projects" << evicted << "- cache size now" << totalSize << "bytes";
+    return evicted;
+}
+
+QVariantList ProjectCache::toVariantList()
+{
+    ensureLoaded();
+
+    QVector<const Entry*> entries;
+    for (const Entry& cached: mEntries)
+        entries.append(&cached);
+
+    // Most recently used first
+    std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b)
+    {
+        return a->lastUsed > b->lastUsed;
+    });
+
+    QVariantList list;
+    for (const Entry* cached: entries)
+    {
+        list.append(QVariantMap
+        {
+            { "name", cached->name },
+            { "size", cached->size },
+            { "lastUsed", cached->lastUsed.toLocalTime() }
+        });
+    }
+    return list;
+}
+
+QByteArray ProjectCache::manifestHash(const QString &pFolderChangeMessage)
+{
+    // The file list and contents, regardless of the file shown
+    int currentFileBegin = pFolderChangeMessage.indexOf("<currentfile>");
+    int currentFileEnd = pFolderChangeMessage.indexOf("</currentfile>");
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    auto addChars = [&](int pFrom, int pLength)
+    {
+        hash.addData(reinterpret_cast<const char*>(pFolderChangeMessage.constData() + pFrom),
+                     pLength * int(sizeof(QChar)));
+    };
+
+    if (currentFileBegin < 0 || currentFileEnd < currentFileBegin)
+    {
+        addChars(0, pFolderChangeMessage.size());
+    }
+    else
+    {
+        addChars(0, currentFileBegin);
+        currentFileEnd += int(qstrlen("</currentfile>"));
+        addChars(currentFileEnd, pFolderChangeMessage.size() - currentFileEnd);
+    }
+    return hash.result();
+}
+
+qint64 ProjectCache::directorySize(const QString &pPath)
+{
+    qint64 size = 0;
+    QDirIterator it(pPath, QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        size += it.fileInfo().size();
+    }
+    return size;
+}
+
+void ProjectCache::ensureLoaded()
+{
+    if (mLoaded)
+        return;
+    mLoaded = true;
+
+    QFile file(mIndexPath);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        QJsonArray projects = QJsonDocument::fromJson(file.readAll()).object().value("projects").toArray();
+        for (const QJsonValue& value: projects)
+        {
+            QJsonObject project = value.toObject();
+
+            Entry cached;
+            cached.name = project.value("name").toString();
+            cached.remoteFolder = project.value("remoteFolder").toString();
+            cached.currentFile = project.value("currentFile").toString();
+            cached.manifestHash = QByteArray::fromHex(project.value("manifestHash").toString().toLatin1());
+            cached.size = qint64(project.value("size").toDouble());
+            cached.lastUsed = QDateTime::fromString(project.value("lastUsed").toString(), Qt::ISODate);
+            cached.webView = project.value("webView").toBool();
+
+            if (!cached.name.isEmpty() && QFileInfo(projectPath(cached.name)).isDir())
+                mEntries.insert(cached.name, cached);
+        }
+    }
+
+    // Projects pushed before the index existed are the first to go
+    const QStringList directories = QDir(mProjectsPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& name: directories)
+    {
+        if (mEntries.contains(name))
+            continue;
+
+        Entry cached;
+        cached.name = name;
+        cached.size = directorySize(projectPath(name));
+        cached.lastUsed = QFileInfo(projectPath(name)).lastModified().toUTC();
+        mEntries.insert(name, cached);
+    }
+}
+
+void ProjectCache::save() const
+{
+    QJsonArray projects;
+    for (const Entry& cached: mEntries)
+    {
+        projects.append(QJsonObject
+        {
+            { "name", cached.name },
+            { "remoteFolder", cached.remoteFolder },
+            { "currentFile", cached.currentFile },
+            { "manifestHash", QString::fromLatin1(cached.manifestHash.toHex()) },
+            { "size", double(cached.size) },
+            { "lastUsed", cached.lastUsed.toString(Qt::ISODate) },
+            { "webView", cached.webView }
+        });
+    }
+
+    // Never leave a truncated index behind
+    QSaveFile file(mIndexPath);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(QJsonObject { { "projects", projects } }).toJson()) < 0 ||
+        !file.commit())
+    {
+        qDebug() << "Could not save the project index" << mIndexPath;
+    }
+}
+
+QString ProjectCache::projectPath(const QString &pName) const
+{
+    return mProjectsPath + pName;
+}
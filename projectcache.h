@@ -0,0 +1,68 @@
+#ifndef PROJECTCACHE_H
+#define PROJECTCACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+
+// ---------------------------------------------------------------
+// ProjectCache
+// ---------------------------------------------------------------
+
+// Index of the projects materialized under the projects path (size, last use, manifest hash),
+// persisted as JSON next to it. Least recently used projects are evicted beyond the disk budget.
+// Not thread-safe: meant to be owned by the sync thread.
+class ProjectCache
+{
+public:
+    struct Entry
+    {
+        QString name;
+        QString remoteFolder;
+        QString currentFile; // relative to the project directory
+        QByteArray manifestHash;
+        qint64 size = 0;
+        QDateTime lastUsed;
+        bool webView = false;
+    };
+
+    // The index is loaded on first use
+    void setPaths(const QString& pProjectsPath, const QString& pIndexPath);
+    void setBudget(qint64 pBytes);
+
+    // True when the project on disk still matches this manifest
+    bool isUpToDate(const QString& pName, const QByteArray& pManifestHash);
+    const Entry* entry(const QString& pName);
+
+    // After the project has been materialized: measures it and marks it as used
+    void update(const Entry& pEntry);
+    void touch(const QString& pName, const QString& pCurrentFile = QString());
+
+    // The project was modified locally, its manifest no longer applies
+    void invalidate(const QString& pName);
+
+    // Removes least recently used projects until the budget is met. Returns their names.
+    QStringList evict(const QString& pKeep);
+
+    QVariantList toVariantList();
+
+    static QByteArray manifestHash(const QString& pFolderChangeMessage);
+    static qint64 directorySize(const QString& pPath);
+
+protected:
+    void ensureLoaded();
+    void save() const;
+    QString projectPath(const QString& pName) const;
+
+private:
+    QString mProjectsPath;
+    QString mIndexPath;
+    qint64 mBudget = 0; // bytes, 0 means unbounded
+    bool mLoaded = false;
+    QHash<QString, Entry> mEntries;
+};
+
+#endif // PROJECTCACHE_H
@@ -0,0 +1,140 @@
+#include "reloadscheduler.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QQuickWindow>
+
+namespace
+{
+const double kFrameBudget = 16.0;   // ms
+const double kSmoothing = 0.3;      // weight of the last measure in the average
+const int kMaxReloadInterval = 1000; // ms
+const int kLoadTimeout = 5000;      // ms, after which a load that never reported is ignored
+}
+
+// ---------------------------------------------------------------
+// ReloadScheduler
+// ---------------------------------------------------------------
+
+ReloadScheduler::ReloadScheduler(QObject *parent)
+    : QObject(parent)
+{
+    mIntervalTimer.setSingleShot(true);
+    connect(&mIntervalTimer, &QTimer::timeout, this, &ReloadScheduler::onIntervalElapsed);
+
+    // A load may never report, e.g. an error without status change: the pending requests must not wait for the next push
+    mLoadTimeoutTimer.setSingleShot(true);
+    mLoadTimeoutTimer.setInterval(kLoadTimeout);
+    connect(&mLoadTimeoutTimer, &QTimer::timeout, this, &ReloadScheduler::onLoadTimeout);
+}
+
+void ReloadScheduler::setWindow(QQuickWindow *pWindow)
+{
+    if (mWindow)
+        disconnect(mWindow, nullptr, this, nullptr);
+
+    mWindow = pWindow;
+
+    // afterAnimating is emitted on the GUI thread, once per frame, before polish and sync
+    if (mWindow)
+        connect(mWindow, &QQuickWindow::afterAnimating, this, &ReloadScheduler::onAfterAnimating);
+}
+
+void ReloadScheduler::requestReload(const QString &pFile, const QString &pSource)
+{
+    if (pFile.isEmpty())
+        return;
+
+    if (mCoalescing)
+        mPendingRequests.clear();
+    mPendingRequests.enqueue({ pFile, pSource });
+
+    // A load in progress will reschedule once it reports
+    if (isLoading())
+        return;
+
+    scheduleReload();
+}
+
+void ReloadScheduler::documentLoaded()
+{
+    if (!mLoading)
+        return;
+    mLoading = false;
+    mLoadTimeoutTimer.stop();
+
+    double loadTime = mLoadTimer.nsecsElapsed() / 1000000.0;
+    mAverageLoadTime = mAverageLoadTime <= 0.0 ? loadTime :
+                                                 kSmoothing * loadTime + (1.0 - kSmoothing) * mAverageLoadTime;
+
+    if (!mPendingRequests.isEmpty())
+        scheduleReload();
+}
+
+void ReloadScheduler::setCoalescing(bool pCoalescing)
+{
+    mCoalescing = pCoalescing;
+}
+
+int ReloadScheduler::reloadInterval() const
+{
+    if (mAverageLoadTime <= kFrameBudget)
+        return 0;
+
+    return qMin(int(2.0 * mAverageLoadTime), kMaxReloadInterval);
+}
+
+double ReloadScheduler::averageLoadTime() const
+{
+    return mAverageLoadTime;
+}
+
+void ReloadScheduler::scheduleReload()
+{
+    // Throttle rather than debounce, so that a continuous stream of edits still renders
+    if (mIntervalTimer.isActive() || mReloadDue)
+        return;
+
+    mIntervalTimer.start(reloadInterval());
+}
+
+void ReloadScheduler::onIntervalElapsed()
+{
+    mReloadDue = true;
+
+    if (mWindow && mWindow->isVisible())
+        mWindow->update(); // the reload happens in the next frame
+    else
+        onAfterAnimating();
+}
+
+void ReloadScheduler::onAfterAnimating()
+{
+    if (!mReloadDue || mPendingRequests.isEmpty())
+        return;
+
+    mReloadDue = false;
+    mLoading = true;
+
+    Request request = mPendingRequests.dequeue();
+    QString source = !request.source.isEmpty() ? request.source :
+                                                 request.file + "?=" + QString::number(QDateTime::currentMSecsSinceEpoch());
+
+    mLoadTimer.start();
+    mLoadTimeoutTimer.start();
+    emit reloadRequested(source);
+}
+
+void ReloadScheduler::onLoadTimeout()
+{
+    qDebug() << "Document load did not report within" << kLoadTimeout << "ms";
+    mLoading = false;
+
+    if (!mPendingRequests.isEmpty())
+        scheduleReload();
+}
+
+bool ReloadScheduler::isLoading() const
+{
+    return mLoading && mLoadTimer.elapsed() < kLoadTimeout;
+}
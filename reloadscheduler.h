@@ -0,0 +1,71 @@
+#ifndef RELOADSCHEDULER_H
+#define RELOADSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QQuickWindow;
+QT_END_NAMESPACE
+
+// ---------------------------------------------------------------
+// ReloadScheduler
+// ---------------------------------------------------------------
+
+// Coalesces reload requests of the current document to at most one per rendered frame.
+// Without coalescing, every request is kept and reloaded in turn.
+// The minimum delay between two reloads follows the measured load time of the document:
+// fast documents reload on the next frame, heavy ones are throttled.
+class ReloadScheduler: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReloadScheduler(QObject* parent = nullptr);
+
+    void setWindow(QQuickWindow* pWindow);
+
+    // pSource replaces the cache-busting source of pFile, e.g. to reuse a compiled component
+    void requestReload(const QString& pFile, const QString& pSource = QString());
+    void documentLoaded();
+
+    // On by default: a request replaces the one still waiting
+    void setCoalescing(bool pCoalescing);
+
+    int reloadInterval() const;
+    double averageLoadTime() const;
+
+signals:
+    void reloadRequested(QString source);
+
+protected:
+    void scheduleReload();
+    void onIntervalElapsed();
+    void onAfterAnimating();
+    void onLoadTimeout();
+    bool isLoading() const;
+
+private:
+    QPointer<QQuickWindow> mWindow;
+    QTimer mIntervalTimer;
+    QTimer mLoadTimeoutTimer;
+    QElapsedTimer mLoadTimer;
+
+    struct Request
+    {
+        QString file;
+        QString source;
+    };
+
+    QQueue<Request> mPendingRequests;
+    bool mCoalescing = true;
+    bool mReloadDue = false;
+    bool mLoading = false;
+
+    double mAverageLoadTime = 0.0; // ms, exponential moving average
+};
+
+#endif // RELOADSCHEDULER_H
@@ -0,0 +1,181 @@
+#include "renderworker.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QSGRendererInterface>
+
+#include "applicationcontrol.h"
+
+namespace
+{
+const int kTrimCacheInterval = 50; // renders
+}
+
+// ---------------------------------------------------------------
+// RenderWorker
+// ---------------------------------------------------------------
+
+RenderWorker::RenderWorker(ApplicationControl *pAppControl, const QString &pOutputDir, QObject *parent)
+    : QObject(parent),
+      mAppControl(pAppControl),
+      mOutputDir(pOutputDir)
+{
+}
+
+void RenderWorker::prepareEnvironment()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // No GPU on build agents: the software scene graph is the fastest reliable option there
+    QQuickWindow::setSceneGraphBackend(QSGRendererInterface::Software);
+}
+
+bool RenderWorker::start(const QString &pServerAddress)
+{
+    if (!QDir().mkpath(mOutputDir))
+    {
+        qCritical() << "Could not create" << mOutputDir;
+        return false;
+    }
+
+    mReport.setFileName(mOutputDir + "/renders.jsonl");
+    if (!mReport.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        qCritical() << "Could not open" << mReport.fileName();
+        return false;
+    }
+
+    mView.setResizeMode(QQuickView::SizeRootObjectToView);
+    mView.resize(640, 480);
+    mView.engine()->rootContext()->setContextProperty("appControl", mAppControl);
+
+    mAppControl->setEngine(mView.engine());
+    mAppControl->setWarmUpEnabled(false); // only pushed documents are rendered
+    mAppControl->setReloadCoalescing(false);
+    mAppControl->setLastProjectRecorded(false);
+    mAppControl->setWindow(&mView);
+
+    connect(mAppControl, &ApplicationControl::reloadRequested, this, &RenderWorker::render);
+    connect(&mView, &QQuickView::statusChanged, this, &RenderWorker::onStatusChanged);
+    connect(&mView, &QQuickWindow::frameSwapped, this, &RenderWorker::onFrameSwapped, Qt::QueuedConnection);
+
+    // Follow the given server, or the first one discovered
+    if (!pServerAddress.isEmpty())
+    {
+        mAppControl->setActiveServerIp(pServerAddress);
+    }
+    else
+    {
+        connect(mAppControl, &ApplicationControl::hostsChanged, this, [=](QVariantList hosts)
+        {
+            if (mAppControl->activeServerIp().isEmpty() && !hosts.isEmpty())
+                mAppControl->setActiveServerIp(hosts.first().toMap().value("address").toString());
+        });
+    }
+
+    mView.show();
+
+    qInfo() << "Render worker writing to" << mOutputDir;
+    return true;
+}
+
+void RenderWorker::render(const QString &pSource)
+{
+    // The scheduler moves on once a document is ready, possibly before its frame is saved
+    mPendingSources.enqueue(pSource);
+    if (!mRendering)
+        renderNext();
+}
+
+void RenderWorker::renderNext()
+{
+    if (mPendingSources.isEmpty())
+        return;
+    mRendering = true;
+
+    if (++mRenderCount % kTrimCacheInterval == 0)
+        mView.engine()->trimComponentCache();
+
+    mSource = mPendingSources.dequeue();
+    mAwaitingFrame = false;
+    mLoadTime = 0.0;
+
+    mTimer.start();
+    mView.setSource(QUrl(mSource));
+}
+
+void RenderWorker::onStatusChanged(QQuickView::Status pStatus)
+{
+    if (pStatus == QQuickView::Ready)
+    {
+        mLoadTime = mTimer.nsecsElapsed() / 1000000.0;
+        mAwaitingFrame = true;
+        mAppControl->documentLoaded();
+        mView.update();
+    }
+    else if (pStatus == QQuickView::Error)
+    {
+        mLoadTime = mTimer.nsecsElapsed() / 1000000.0;
+        mAppControl->documentLoaded();
+        saveResult(QString(), -1.0);
+    }
+}
+
+void RenderWorker::onFrameSwapped()
+{
+    if (!mAwaitingFrame)
+        return;
+    mAwaitingFrame = false;
+    double firstFrameTime = mTimer.nsecsElapsed() / 1000000.0;
+
+    QString imagePath = QString("%1/%2_%3.png")
+                        .arg(mOutputDir)
+                        .arg(mRenderCount, 5, 10, QChar('0'))
+                        .arg(QFileInfo(QUrl(mSource).path()).completeBaseName());
+
+    if (!mView.grabWindow().save(imagePath, "PNG"))
+    {
+        qDebug() << "Could not save" << imagePath;
+        imagePath.clear();
+    }
+    saveResult(imagePath, firstFrameTime);
+}
+
+void RenderWorker::saveResult(const QString &pImagePath, double pFirstFrameTime)
+{
+    QJsonArray errors;
+    for (const QQmlError& error: mView.errors())
+        errors.append(error.toString());
+
+    QJsonObject result
+    {
+        { "source", QUrl(mSource).toString(QUrl::RemoveQuery) },
+        { "status", mView.status() == QQuickView::Ready ? "ready" : "error" },
+        { "loadMs", mLoadTime },
+        { "firstFrameMs", pFirstFrameTime },
+        { "image", pImagePath },
+        { "errors", errors }
+    };
+
+    mReport.write(QJsonDocument(result).toJson(QJsonDocument::Compact) + "\n");
+    mReport.flush();
+
+    qInfo().noquote() << QString("Rendered %1 (%2): load %3 ms")
+                         .arg(result["source"].toString(), result["status"].toString())
+                         .arg(mLoadTime, 0, 'f', 1);
+
+    // Not from the status handler of the view: a load error would render the next document recursively
+    mRendering = false;
+    QMetaObject::invokeMethod(this, [=]()
+    {
+        if (!mRendering)
+            renderNext();
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,54 @@
+#ifndef RENDERWORKER_H
+#define RENDERWORKER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QQuickView>
+#include <QQueue>
+
+class ApplicationControl;
+
+// ---------------------------------------------------------------
+// RenderWorker
+// ---------------------------------------------------------------
+
+// Headless mode (offscreen platform, no browser UI): renders each document pushed by the server
+// and saves the first frame as PNG, along with a line of timings in renders.jsonl.
+// Documents pushed during a render are queued: each one gets its image and its line.
+class RenderWorker: public QObject
+{
+    Q_OBJECT
+
+public:
+    RenderWorker(ApplicationControl* pAppControl, const QString& pOutputDir, QObject* parent = nullptr);
+
+    bool start(const QString& pServerAddress = QString());
+
+    // Must be called before the QGuiApplication is created
+    static void prepareEnvironment();
+
+protected:
+    void render(const QString& pSource);
+    void renderNext();
+    void onStatusChanged(QQuickView::Status pStatus);
+    void onFrameSwapped();
+    void saveResult(const QString& pImagePath, double pFirstFrameTime);
+
+private:
+    ApplicationControl* mAppControl = nullptr;
+    QString mOutputDir;
+
+    QQuickView mView;
+    QFile mReport;
+
+    QQueue<QString> mPendingSources;
+    QString mSource;
+    bool mRendering = false;
+    int mRenderCount = 0;
+    bool mAwaitingFrame = false;
+    QElapsedTimer mTimer;
+    double mLoadTime = 0.0;
+};
+
+#endif // RENDERWORKER_H
@@ -0,0 +1,178 @@
+#include "sessionrecorder.h"
+
+#include <QDebug>
+
+namespace
+{
+const QByteArray kMagic = "QPGSREC1";
+
+enum FrameType : quint8
+{
+    TextFrame = 0,
+    BinaryFrame = 1
+};
+}
+
+// ---------------------------------------------------------------
+// SessionRecorder
+// ---------------------------------------------------------------
+
+bool SessionRecorder::start(const QString &pFilePath)
+{
+    stop();
+
+    mFile.setFileName(QString(pFilePath).replace("file:///", ""));
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "Could not open recording" << mFile.fileName() << mFile.errorString();
+        return false;
+    }
+
+    mFile.write(kMagic);
+    mStream.setDevice(&mFile);
+    mStream.setVersion(QDataStream::Qt_5_9);
+    mClock.start();
+
+    qDebug() << "Recording session to" << mFile.fileName();
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    if (!mFile.isOpen())
+        return;
+
+    mStream.setDevice(nullptr);
+    mFile.close();
+    qDebug() << "Session recorded to" << mFile.fileName();
+}
+
+bool SessionRecorder::isRecording() const
+{
+    return mFile.isOpen();
+}
+
+void SessionRecorder::recordTextMessage(const QString &pMessage)
+{
+    record(TextFrame, pMessage.toUtf8());
+}
+
+void SessionRecorder::recordBinaryMessage(const QByteArray &pMessage)
+{
+    record(BinaryFrame, pMessage);
+}
+
+void SessionRecorder::record(quint8 pType, const QByteArray &pPayload)
+{
+    if (!isRecording())
+        return;
+
+    mStream << qint64(mClock.nsecsElapsed()) << pType << pPayload;
+}
+
+// ---------------------------------------------------------------
+// SessionPlayer
+// ---------------------------------------------------------------
+
+SessionPlayer::SessionPlayer(QObject *parent)
+    : QObject(parent)
+{
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &SessionPlayer::playNextFrames);
+}
+
+bool SessionPlayer::load(const QString &pFilePath)
+{
+    stop();
+    mFrames.clear();
+
+    QFile file(QString(pFilePath).replace("file:///", ""));
+    if (!file.open(QIODevice::ReadOnly) || file.read(kMagic.size()) != kMagic)
+    {
+        qDebug() << "Not a session recording:" << file.fileName();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    while (!stream.atEnd())
+    {
+        Frame frame;
+        stream >> frame.timestamp >> frame.type >> frame.payload;
+        if (stream.status() != QDataStream::Ok)
+        {
+            qDebug() << "Truncated session recording, keeping" << mFrames.size() << "frames";
+            break;
+        }
+        mFrames.append(frame);
+    }
+    return true;
+}
+
+void SessionPlayer::play(double pSpeed)
+{
+    stop();
+
+    mSpeed = pSpeed;
+    mNextFrame = 0;
+    mClock.start();
+    mTimer.start(0);
+}
+
+void SessionPlayer::stop()
+{
+    mTimer.stop();
+}
+
+bool SessionPlayer::isPlaying() const
+{
+    return mTimer.isActive();
+}
+
+int SessionPlayer::frameCount() const
+{
+    return mFrames.size();
+}
+
+void SessionPlayer::playNextFrames()
+{
+    if (mNextFrame >= mFrames.size())
+    {
+        emit finished();
+        return;
+    }
+
+    const qint64 startTimestamp = mFrames.first().timestamp;
+    const bool maxSpeed = mSpeed <= 0.0;
+
+    // As fast as possible still yields to the event loop between frames
+    while (mNextFrame < mFrames.size())
+    {
+        const Frame& frame = mFrames.at(mNextFrame);
+        if (!maxSpeed && (frame.timestamp - startTimestamp) / mSpeed > mClock.nsecsElapsed())
+            break;
+
+        ++mNextFrame;
+        if (frame.type == TextFrame)
+            emit textMessage(QString::fromUtf8(frame.payload));
+        else
+            emit binaryMessage(frame.payload);
+
+        if (maxSpeed)
+            break;
+    }
+
+    if (mNextFrame >= mFrames.size())
+    {
+        emit finished();
+        return;
+    }
+
+    qint64 delay = 0;
+    if (!maxSpeed)
+    {
+        qint64 dueTime = qint64((mFrames.at(mNextFrame).timestamp - startTimestamp) / mSpeed);
+        delay = qMax(qint64(0), (dueTime - mClock.nsecsElapsed()) / 1000000);
+    }
+    mTimer.start(int(delay));
+}
@@ -0,0 +1,79 @@
+#ifndef SESSIONRECORDER_H
+#define SESSIONRECORDER_H
+
+#include <QObject>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
+#include <QVector>
+
+// Recording file: "QPGSREC1", then for each frame
+// [qint64 ns since recording start][quint8 frame type][QByteArray payload (utf-8 for text)]
+
+// ---------------------------------------------------------------
+// SessionRecorder
+// ---------------------------------------------------------------
+
+class SessionRecorder
+{
+public:
+    bool start(const QString& pFilePath);
+    void stop();
+    bool isRecording() const;
+
+    void recordTextMessage(const QString& pMessage);
+    void recordBinaryMessage(const QByteArray& pMessage);
+
+private:
+    void record(quint8 pType, const QByteArray& pPayload);
+
+    QFile mFile;
+    QDataStream mStream;
+    QElapsedTimer mClock;
+};
+
+// ---------------------------------------------------------------
+// SessionPlayer
+// ---------------------------------------------------------------
+
+// Replays a recording with its original timing, scaled by speed (0 for as fast as possible).
+class SessionPlayer: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionPlayer(QObject* parent = nullptr);
+
+    bool load(const QString& pFilePath);
+    void play(double pSpeed);
+    void stop();
+    bool isPlaying() const;
+
+    int frameCount() const;
+
+signals:
+    void textMessage(QString message);
+    void binaryMessage(QByteArray message);
+    void finished();
+
+protected:
+    void playNextFrames();
+
+private:
+    struct Frame
+    {
+        qint64 timestamp = 0;
+        quint8 type = 0;
+        QByteArray payload;
+    };
+
+    QVector<Frame> mFrames;
+    int mNextFrame = 0;
+    double mSpeed = 1.0;
+
+    QTimer mTimer;
+    QElapsedTimer mClock;
+};
+
+#endif // SESSIONRECORDER_H
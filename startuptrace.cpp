@@ -0,0 +1,78 @@
+#include "startuptrace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QStringList>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------
+// StartupTrace
+// ---------------------------------------------------------------
+
+void StartupTrace::start()
+{
+    mClock.start();
+    mLastMark = 0;
+    mPhases.clear();
+
+    qint64 libraryLoad = libraryLoadTime();
+    if (libraryLoad >= 0)
+        mPhases.append(qMakePair(QString("library load"), double(libraryLoad)));
+}
+
+void StartupTrace::mark(const QString &pPhase)
+{
+    qint64 now = mClock.nsecsElapsed();
+    mPhases.append(qMakePair(pPhase, (now - mLastMark) / 1000000.0));
+    mLastMark = now;
+}
+
+QVariantMap StartupTrace::toVariantMap() const
+{
+    QVariantList phases;
+    double total = 0.0;
+    for (const auto& phase: mPhases)
+    {
+        phases.append(QVariantMap { { "phase", phase.first }, { "ms", phase.second } });
+        total += phase.second;
+    }
+    return QVariantMap { { "phases", phases }, { "totalMs", total } };
+}
+
+void StartupTrace::log() const
+{
+    QStringList phases;
+    double total = 0.0;
+    for (const auto& phase: mPhases)
+    {
+        phases << QString("%1 %2 ms").arg(phase.first).arg(phase.second, 0, 'f', 1);
+        total += phase.second;
+    }
+    qInfo().noquote() << QString("Startup: %1 ms (%2)").arg(total, 0, 'f', 1).arg(phases.join(", "));
+}
+
+qint64 StartupTrace::libraryLoadTime()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    // Process start time (field 22 of /proc/self/stat, in clock ticks since boot) against the uptime
+    QFile statFile("/proc/self/stat");
+    QFile uptimeFile("/proc/uptime");
+    if (!statFile.open(QIODevice::ReadOnly) || !uptimeFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    // The command name (field 2) may contain spaces: count fields after its closing parenthesis
+    QByteArray stat = statFile.readAll();
+    QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 20)
+        return -1;
+
+    double startTime = fields.at(19).toDouble() / sysconf(_SC_CLK_TCK);
+    double uptime = uptimeFile.readAll().split(' ').first().toDouble();
+    return qMax(qint64(0), qint64((uptime - startTime) * 1000.0));
+#else
+    return -1;
+#endif
+}
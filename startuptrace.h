@@ -0,0 +1,35 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QPair>
+#include <QVariantMap>
+#include <QVector>
+
+// ---------------------------------------------------------------
+// StartupTrace
+// ---------------------------------------------------------------
+
+// Breaks launch time down into consecutive phases, from process start to the first frame.
+class StartupTrace
+{
+public:
+    // Call first thing in main()
+    void start();
+
+    // Ends the current phase
+    void mark(const QString& pPhase);
+
+    QVariantMap toVariantMap() const;
+    void log() const;
+
+    // Time between process creation and main(), -1 where unavailable
+    static qint64 libraryLoadTime();
+
+private:
+    QElapsedTimer mClock;
+    qint64 mLastMark = 0;
+    QVector<QPair<QString, double>> mPhases; // ms
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,176 @@
+#include "syncsession.h"
+
+#include <QDebug>
+#include <QSettings>
+#include <QTimer>
+#include <QUrl>
+#include <QWebSocket>
+
+#include "syncworker.h"
+
+namespace
+{
+const int kReconnectDelay = 2000; // ms
+}
+
+// ---------------------------------------------------------------
+// SyncSession
+// ---------------------------------------------------------------
+
+SyncSession::SyncSession(const QString &pId, const QString &pServerAddress, const QString &pWritePath, QObject *parent)
+    : QObject(parent),
+      mId(pId),
+      mServerAddress(pServerAddress),
+      mWritePath(pWritePath)
+{
+    mSocket = new QWebSocket();
+    mWorker = new SyncWorker();
+    mWorker->setWritePath(mWritePath);
+    mWorker->setProjectsPath(projectsPath());
+    mWorker->setProjectsBudget(QSettings().value("cache/projectsBudget", 512 * 1024 * 1024).toLongLong());
+
+    mSocket->moveToThread(&mThread);
+    mWorker->moveToThread(&mThread);
+    connect(&mThread, &QThread::finished, mSocket, &QObject::deleteLater);
+    connect(&mThread, &QThread::finished, mWorker, &QObject::deleteLater);
+
+    // Everything below runs on the session thread
+    connect(mSocket, &QWebSocket::textMessageReceived, mWorker, [=](const QString& pMessage)
+    {
+        countMessage();
+        mWorker->postTextMessage(pMessage);
+    });
+    connect(mSocket, &QWebSocket::binaryMessageReceived, mWorker, [=](const QByteArray& pMessage)
+    {
+        countMessage();
+        mWorker->postBinaryMessage(pMessage);
+    });
+    connect(mSocket, &QWebSocket::connected, mSocket, [=]()
+    {
+        mSocket->sendTextMessage(SyncWorker::capabilitiesMessage());
+        setConnected(true);
+    });
+    connect(mSocket, &QWebSocket::disconnected, mSocket, [=]()
+    {
+        setConnected(false);
+        QTimer::singleShot(kReconnectDelay, mSocket, [=]() { connectSocket(); });
+    });
+
+    connect(mWorker, &SyncWorker::projectReady, mWorker, [=](const QString&, const QString& pProjectPath)
+    {
+        setProject(pProjectPath);
+    });
+    connect(mWorker, &SyncWorker::currentFileReady, mWorker, [=](const QString& pCurrentFile)
+    {
+        setCurrentFile(pCurrentFile);
+    });
+    connect(mWorker, &SyncWorker::resyncRequired, mSocket, [=](const QString& pRemoteFile)
+    {
+        if (mSocket->state() == QAbstractSocket::ConnectedState)
+            mSocket->sendTextMessage(SyncWorker::resyncMessage(pRemoteFile));
+    });
+    connect(mWorker, &SyncWorker::assetImportFinished, mWorker, [=](const QString& pErrorString)
+    {
+        if (!pErrorString.isEmpty())
+            qDebug() << "Session" << mId << "import failed:" << pErrorString;
+    });
+
+    mThread.setObjectName("SyncSession " + mId);
+}
+
+SyncSession::~SyncSession()
+{
+    if (!mThread.isRunning())
+    {
+        delete mSocket;
+        delete mWorker;
+        return;
+    }
+
+    // No reconnection once the session is going away
+    QMetaObject::invokeMethod(mSocket, [=]()
+    {
+        mSocket->disconnect();
+        mSocket->abort();
+    }, Qt::BlockingQueuedConnection);
+
+    mThread.quit();
+    mThread.wait();
+}
+
+void SyncSession::start()
+{
+    mThread.start();
+    QMetaObject::invokeMethod(mSocket, [=]() { connectSocket(); }, Qt::QueuedConnection);
+}
+
+QString SyncSession::id() const
+{
+    return mId;
+}
+
+QString SyncSession::serverAddress() const
+{
+    return mServerAddress;
+}
+
+QString SyncSession::projectsPath() const
+{
+    return mWritePath + "/projects/";
+}
+
+QVariantMap SyncSession::toVariantMap() const
+{
+    QMutexLocker locker(&mMutex);
+    return QVariantMap
+    {
+        { "id", mId },
+        { "address", mServerAddress },
+        { "connected", mConnected },
+        { "messages", mMessages },
+        { "projectPath", mProjectPath },
+        { "currentFile", mCurrentFile }
+    };
+}
+
+void SyncSession::connectSocket()
+{
+    qDebug() << "Session" << mId << "connecting to" << mServerAddress;
+    mSocket->open(QUrl(QString("ws://%1").arg(mServerAddress)));
+}
+
+void SyncSession::setConnected(bool pConnected)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        if (mConnected == pConnected)
+            return;
+        mConnected = pConnected;
+    }
+    emit changed(mId);
+}
+
+void SyncSession::countMessage()
+{
+    QMutexLocker locker(&mMutex);
+    mMessages++;
+}
+
+void SyncSession::setProject(const QString &pProjectPath)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mProjectPath = pProjectPath;
+    }
+    emit changed(mId);
+}
+
+void SyncSession::setCurrentFile(const QString &pCurrentFile)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mCurrentFile = pCurrentFile;
+    }
+    emit changed(mId);
+    emit currentFileReady(mId, pCurrentFile);
+}
@@ -0,0 +1,69 @@
+#ifndef SYNCSESSION_H
+#define SYNCSESSION_H
+
+#include <QObject>
+#include <QMutex>
+#include <QThread>
+#include <QVariantMap>
+
+QT_BEGIN_NAMESPACE
+class QWebSocket;
+QT_END_NAMESPACE
+
+class SyncWorker;
+
+// ---------------------------------------------------------------
+// SyncSession
+// ---------------------------------------------------------------
+
+// Follows one more server, next to the one shown by ApplicationControl: its own socket,
+// sync worker (parsing, writes, asset import) and project directory, all on a thread of its own.
+// Reconnects on its own when the connection drops.
+class SyncSession: public QObject
+{
+    Q_OBJECT
+
+public:
+    SyncSession(const QString& pId, const QString& pServerAddress, const QString& pWritePath, QObject* parent = nullptr);
+    ~SyncSession();
+
+    void start();
+
+    QString id() const;
+    QString serverAddress() const;
+    QString projectsPath() const;
+
+    // Thread-safe: { id, address, connected, messages, projectPath, currentFile }
+    QVariantMap toVariantMap() const;
+
+signals:
+    // Emitted from the session thread
+    void changed(QString id);
+    void currentFileReady(QString id, QString currentFile);
+
+protected:
+    void connectSocket();
+    void setConnected(bool pConnected);
+    void countMessage();
+    void setProject(const QString& pProjectPath);
+    void setCurrentFile(const QString& pCurrentFile);
+
+private:
+    const QString mId;
+    const QString mServerAddress;
+    const QString mWritePath;
+
+    QThread mThread;
+
+    // Live on mThread, deleted with it
+    QWebSocket* mSocket = nullptr;
+    SyncWorker* mWorker = nullptr;
+
+    mutable QMutex mMutex;
+    bool mConnected = false;
+    int mMessages = 0;
+    QString mProjectPath;
+    QString mCurrentFile;
+};
+
+#endif // SYNCSESSION_H
@@ -0,0 +1,768 @@
+#include "syncworker.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "assetbundle.h"
+#include "logging.h"
+
+inline QString beginTag(const QString& tag)
+{
+    return "<" + tag + ">";
+}
+
+inline QString endTag(const QString& tag)
+{
+    return "</" + tag + ">";
+}
+
+// QtWebView must be initialized at startup: remember which projects need it
+inline bool importsWebView(const QString& pContent)
+{
+    return pContent.contains("import QtWebView");
+}
+
+// Replacement of the bytes [offset, offset + length[ of a file, in a filepatch message
+struct TextEdit
+{
+    int offset = 0;
+    int length = 0;
+    QByteArray text;
+};
+
+// <edit>offset,length</edit><text>replacement</text> pairs, in any order
+inline bool parseEdits(const QString& pMessage, QVector<TextEdit>& pEdits)
+{
+    int lastEditIndex = 0;
+    QString range = SyncWorker::messageContent(pMessage, "edit");
+    while (!range.isEmpty())
+    {
+        TextEdit edit;
+        bool offsetOk = false;
+        bool lengthOk = false;
+        edit.offset = range.section(',', 0, 0).toInt(&offsetOk);
+        edit.length = range.section(',', 1, 1).toInt(&lengthOk);
+
+        int textEnd = pMessage.indexOf(endTag("text"), lastEditIndex);
+        if (!offsetOk || !lengthOk || textEnd < 0)
+            return false;
+
+        edit.text = SyncWorker::messageContent(pMessage, "text", lastEditIndex).toUtf8();
+        pEdits.append(edit);
+
+        lastEditIndex = textEnd + endTag("text").length();
+        range = SyncWorker::messageContent(pMessage, "edit", lastEditIndex);
+    }
+    return !pEdits.isEmpty();
+}
+
+// Offsets refer to the base content: edits are applied from the end so that they stay valid
+inline bool applyEdits(QByteArray& pContent, QVector<TextEdit> pEdits)
+{
+    std::sort(pEdits.begin(), pEdits.end(), [](const TextEdit& a, const TextEdit& b)
+    {
+        return a.offset > b.offset;
+    });
+
+    int end = pContent.size();
+    for (const TextEdit& edit: pEdits)
+    {
+        // Out of range or overlapping the next edit
+        if (edit.offset < 0 || edit.length < 0 || edit.offset + edit.length > end)
+            return false;
+
+        pContent.replace(edit.offset, edit.length, edit.text);
+        end = edit.offset;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------
+// SyncWorker
+// ---------------------------------------------------------------
+
+SyncWorker::SyncWorker(QObject *parent)
+    : QObject(parent),
+      mImportBytes(0),
+      mCacheBytes(0)
+{
+}
+
+QString SyncWorker::messageContent(const QString& message,
+                                   const QString& tag,
+                                   int fromIndex)
+{
+    QString bTag = beginTag(tag);
+    QString eTag = endTag(tag);
+
+    int beginIndex = message.indexOf(bTag, fromIndex);
+    int endIndex = message.indexOf(eTag, fromIndex);
+
+    if (endIndex <= beginIndex)
+        return QString(); // null qstring
+
+    return message.mid(beginIndex + bTag.length(), endIndex - beginIndex - bTag.length());
+}
+
+bool SyncWorker::createFile(QString pPath, QString pFileName, QString pFileContent)
+{
+    QString lPath = pPath.replace("file:///", "");
+    lPath += "/" + pFileName;
+
+    // Ensure target directory exists
+    QString targetDir = lPath.mid(0, lPath.lastIndexOf("/"));
+    QDir().mkpath(targetDir);
+
+    BlobStore::breakLink(lPath);
+    QFile file(lPath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QTextStream textStream(&file);
+        textStream << pFileContent;
+    }
+    else
+    {
+        qCWarning(lcSync) << QString("Unable to create file \"%1\"").arg(lPath);
+        return false;
+    }
+    return true;
+}
+
+QVector<SyncWorker::FileContent> SyncWorker::parseFolderChange(const QString &pMessage)
+{
+    QVector<FileContent> files;
+    int lastFileIndex = 0;
+
+    QString fileName = messageContent(pMessage, "file");
+    QString fileContent = messageContent(pMessage, "content");
+    while (!fileName.isEmpty())
+    {
+        files.append({ fileName, fileContent });
+
+        lastFileIndex = pMessage.indexOf(endTag("content"), lastFileIndex) + endTag("content").length();
+        fileName = messageContent(pMessage, "file", lastFileIndex);
+        fileContent = messageContent(pMessage, "content", lastFileIndex);
+    }
+    return files;
+}
+
+QString SyncWorker::currentFileMessage(const QString &pRemoteFile)
+{
+    return beginTag("messagetype") + "currentfile" + endTag("messagetype")
+         + beginTag("currentfile") + pRemoteFile + endTag("currentfile");
+}
+
+QString SyncWorker::resyncMessage(const QString &pRemoteFile)
+{
+    return beginTag("messagetype") + "resync" + endTag("messagetype")
+         + beginTag("file") + pRemoteFile + endTag("file");
+}
+
+QString SyncWorker::capabilitiesMessage()
+{
+    return beginTag("messagetype") + "capabilities" + endTag("messagetype")
+         + beginTag("assetformats") + AssetBundle::kFormatName + ",zip" + endTag("assetformats");
+}
+
+void SyncWorker::setWritePath(const QString &pWritePath)
+{
+    mWritePath = pWritePath;
+    mBlobStore.setPath(mWritePath + "/blobs");
+}
+
+void SyncWorker::setProjectsPath(const QString &pProjectsPath)
+{
+    mProjectsPath = pProjectsPath;
+
+    // Kept out of the projects path, which is shown as a file tree
+    mProjectCache.setPaths(mProjectsPath, QDir(mProjectsPath).absoluteFilePath("../projects.json"));
+}
+
+void SyncWorker::setProjectsBudget(qint64 pBytes)
+{
+    mProjectCache.setBudget(pBytes);
+}
+
+void SyncWorker::setMemoryStore(MemoryFileStore *pMemoryStore)
+{
+    mMemoryStore = pMemoryStore;
+}
+
+void SyncWorker::setLatencyTracer(LatencyTracer *pLatencyTracer)
+{
+    mLatencyTracer = pLatencyTracer;
+}
+
+void SyncWorker::setCurrentProject(const QString &pFolder, const QString &pProjectPath)
+{
+    mCurrentFolder = pFolder;
+    mCurrentProjectPath = pProjectPath;
+}
+
+void SyncWorker::postTextMessage(const QString &pMessage, quint64 pTraceId)
+{
+    PendingMessage message;
+    message.text = pMessage;
+    message.traceId = pTraceId;
+    post(message);
+}
+
+void SyncWorker::postBinaryMessage(const QByteArray &pMessage, quint64 pTraceId)
+{
+    PendingMessage message;
+    message.isBinary = true;
+    message.data = pMessage;
+    message.traceId = pTraceId;
+    post(message);
+}
+
+void SyncWorker::post(const PendingMessage &pMessage)
+{
+    QMutexLocker locker(&mMutex);
+    mPendingMessages.enqueue(pMessage);
+    mPendingBytes += messageBytes(pMessage);
+
+    // One queued call drains everything that arrived in the meantime
+    if (!mProcessingScheduled)
+    {
+        mProcessingScheduled = true;
+        QMetaObject::invokeMethod(this, "processPendingMessages", Qt::QueuedConnection);
+    }
+}
+
+void SyncWorker::processPendingMessages()
+{
+    forever
+    {
+        QQueue<PendingMessage> messages;
+        {
+            QMutexLocker locker(&mMutex);
+            if (mPendingMessages.isEmpty())
+            {
+                mProcessingScheduled = false;
+                return;
+            }
+            messages.swap(mPendingMessages);
+            mPendingBytes = 0;
+        }
+
+        // Consecutive text messages are coalesced: files are written once with their latest
+        // content and only the final project/current file is reported. Binary messages are barriers.
+        while (!messages.isEmpty())
+        {
+            PendingMessage message = messages.dequeue();
+            if (message.isBinary)
+            {
+                finishBatch();
+                handleBinaryMessage(message.data, message.traceId);
+            }
+            else
+            {
+                handleTextMessage(message.text, message.traceId);
+            }
+        }
+        finishBatch();
+    }
+}
+
+qint64 SyncWorker::messageBytes(const PendingMessage &pMessage)
+{
+    return pMessage.text.size() * qint64(sizeof(QChar)) + pMessage.data.size();
+}
+
+qint64 SyncWorker::pendingBytes() const
+{
+    QMutexLocker locker(&mMutex);
+    return mPendingBytes;
+}
+
+bool SyncWorker::isIdle() const
+{
+    QMutexLocker locker(&mMutex);
+    return !mProcessingScheduled;
+}
+
+qint64 SyncWorker::importBytes() const
+{
+    return mImportBytes.load();
+}
+
+qint64 SyncWorker::cacheBytes() const
+{
+    return mCacheBytes.load();
+}
+
+qint64 SyncWorker::dropSupersededMessages()
+{
+    QMutexLocker locker(&mMutex);
+
+    // Walk backwards: a message is superseded by a later folderchange of its folder,
+    // or by a later filechange of the same file. Binary messages are barriers.
+    QStringList laterFolders;
+    QSet<QString> laterFiles;
+    bool laterCurrentFile = false;
+    qint64 freedBytes = 0;
+
+    for (int i = mPendingMessages.size() - 1; i >= 0; --i)
+    {
+        PendingMessage& message = mPendingMessages[i];
+        if (message.isBinary)
+        {
+            laterFolders.clear();
+            laterFiles.clear();
+            laterCurrentFile = false;
+            continue;
+        }
+
+        QString messageType = messageContent(message.text, "messagetype");
+        bool superseded = false;
+        if (messageType == "folderchange")
+        {
+            QString folder = messageContent(message.text, "folder").remove("\n").remove("file:///");
+            superseded = laterFolders.contains(folder + "/");
+            if (!superseded)
+                laterFolders << folder + "/";
+        }
+        else if (messageType == "filechange" || messageType == "filepatch")
+        {
+            QString file = messageContent(message.text, "file");
+            superseded = laterFiles.contains(file);
+
+            // Files of that folder only: /a/proj does not supersede /a/proj2
+            QString filePath = QString(file).remove("file:///");
+            for (int j = 0; !superseded && j < laterFolders.size(); ++j)
+                superseded = filePath.startsWith(laterFolders.at(j));
+
+            // A patch only makes sense on top of the earlier messages of its file
+            if (!superseded && messageType == "filechange")
+                laterFiles.insert(file);
+        }
+
+        QString currentFile = messageContent(message.text, "currentfile");
+        bool keepCurrentFile = !laterCurrentFile && !currentFile.isEmpty();
+        laterCurrentFile = laterCurrentFile || !currentFile.isEmpty();
+
+        if (superseded && keepCurrentFile)
+        {
+            // The contents are superseded, but this is still the last selection: only keep that
+            qint64 bytes = messageBytes(message);
+            message.text = currentFileMessage(currentFile);
+            freedBytes += bytes - messageBytes(message);
+        }
+        else if (superseded)
+        {
+            freedBytes += messageBytes(message);
+            if (mLatencyTracer && message.traceId)
+                mLatencyTracer->finishTrace(message.traceId);
+            mPendingMessages.removeAt(i);
+        }
+    }
+
+    mPendingBytes -= freedBytes;
+    return freedBytes;
+}
+
+void SyncWorker::trimCaches()
+{
+    mFileWriter.clearCache();
+    clearPatchedFiles();
+    mCacheBytes.store(0);
+}
+
+void SyncWorker::openCachedProject(const QString &pName)
+{
+    const ProjectCache::Entry* cached = mProjectCache.entry(pName);
+    if (!cached)
+    {
+        qCWarning(lcSync) << "Project not in cache:" << pName;
+        return;
+    }
+
+    // Pending messages belong to the previous project
+    finishBatch();
+    if (mMemoryStore)
+        mMemoryStore->clear();
+
+    mCurrentFolder = cached->remoteFolder;
+    mCurrentProjectPath = mProjectsPath + pName;
+    mProjectChanged = true;
+    if (!cached->currentFile.isEmpty())
+        mPendingCurrentFile = "file:///" + mCurrentProjectPath + "/" + cached->currentFile;
+    emit webViewRequired(cached->webView);
+
+    mProjectCache.touch(pName);
+    finishBatch();
+    refreshCachedProjects();
+}
+
+void SyncWorker::invalidateCachedProject(const QString &pPath)
+{
+    QString path = QDir::cleanPath(QString(pPath).replace("file:///", ""));
+    QString projectsPath = QDir::cleanPath(mProjectsPath) + "/";
+    if (!path.startsWith(projectsPath))
+        return;
+
+    mProjectCache.invalidate(path.mid(projectsPath.size()).section('/', 0, 0));
+}
+
+void SyncWorker::refreshCachedProjects()
+{
+    emit cachedProjectsChanged(mProjectCache.toVariantList());
+}
+
+void SyncWorker::handleTextMessage(const QString &pMessage, quint64 pTraceId)
+{
+    // Handle message type
+    QString messageType = messageContent(pMessage, "messagetype");
+
+    if (messageType == "folderchange")
+    {
+        handleFolderChangeMessage(pMessage);
+    }
+    else if (messageType == "filechange")
+    {
+        handleFileChangeMessage(pMessage);
+    }
+    else if (messageType == "filepatch")
+    {
+        handleFilePatchMessage(pMessage);
+    }
+    else if (messageType == "currentfile")
+    {
+        handleCurrentFileChangeMessage(pMessage);
+    }
+    else
+    {
+        if (messageType == "data")
+        {
+            // hand the data message over to the qml
+            emit jsonMessageReady(messageContent(pMessage, "json"));
+        }
+        if (mLatencyTracer && pTraceId)
+            mLatencyTracer->finishTrace(pTraceId);
+        return;
+    }
+
+    // Written once the batch is flushed
+    if (mLatencyTracer && pTraceId)
+    {
+        mLatencyTracer->mark(pTraceId, LatencyTracer::Parsed);
+        mBatchTraces.append(pTraceId);
+    }
+}
+
+void SyncWorker::handleBinaryMessage(const QByteArray &pMessage, quint64 pTraceId)
+{
+    mAssetImporter.messageToProcess = pMessage;
+    mAssetImporter.mWritePath = mWritePath;
+    mAssetImporter.blobStore = &mBlobStore;
+    mImportBytes.store(pMessage.size());
+    mAssetImporter.run();
+
+    BlobStore::Stats blobStats = mBlobStore.takeStats();
+    qCDebug(lcSync) << "Imported" << blobStats.files << "files," << blobStats.reused << "already in the blob store ("
+             << blobStats.bytesReused << "bytes not written)";
+
+    // Do not hold on to the payload until the next import
+    mAssetImporter.messageToProcess.clear();
+    mImportBytes.store(0);
+
+    if (mLatencyTracer && pTraceId)
+    {
+        mLatencyTracer->mark(pTraceId, LatencyTracer::Parsed);
+        mBatchTraces.append(pTraceId);
+    }
+
+    if (mAssetImporter.errorString.isEmpty())
+    {
+        clearPatchedFiles();
+        if (mMemoryStore)
+            mMemoryStore->clear();
+        mCurrentProjectPath = mAssetImporter.projectDir;
+        mProjectChanged = true;
+        // The import keeps the text files of the folderchange: written again only when they changed
+        if (!mAssetImporter.folderChangeMessage.isEmpty())
+            handleFolderChangeMessage(mAssetImporter.folderChangeMessage);
+        else
+            mProjectCache.invalidate(currentProjectName());
+        finishBatch();
+    }
+
+    emit assetImportFinished(mAssetImporter.errorString);
+}
+
+void SyncWorker::handleFolderChangeMessage(const QString &pMessage)
+{
+    // Retrieve distant folder name
+    QString folderName = messageContent(pMessage, "folder").remove("\n");
+    folderName.remove("file:///");
+    mCurrentFolder = folderName;
+    qCDebug(lcSync) << "Folder:" << folderName;
+
+    // Patches that follow are based on these contents
+    clearPatchedFiles();
+    mResyncRequested.clear();
+
+    // Files of the previous push are served from the disk, until written again
+    if (mMemoryStore)
+        mMemoryStore->clear();
+
+    QString projectName = folderName.mid(folderName.lastIndexOf("/") + 1);
+
+    mCurrentProjectPath = mProjectsPath + projectName;
+
+    // Handle the current file first, to record it in the cache
+    handleCurrentFileChangeMessage(pMessage);
+    mProjectChanged = true;
+
+    ProjectCache::Entry cacheEntry;
+    cacheEntry.name = projectName;
+    cacheEntry.remoteFolder = folderName;
+    cacheEntry.manifestHash = ProjectCache::manifestHash(pMessage);
+    if (!mPendingCurrentFile.isEmpty())
+        cacheEntry.currentFile = relativeFilePathFromRemoteFilePath(messageContent(pMessage, "currentfile"));
+
+    // Same files as on disk: nothing to write
+    if (mProjectCache.isUpToDate(projectName, cacheEntry.manifestHash))
+    {
+        qCDebug(lcSync) << "Project" << projectName << "up to date in cache";
+        mProjectCache.touch(projectName, cacheEntry.currentFile);
+        emit webViewRequired(mProjectCache.entry(projectName)->webView);
+        refreshCachedProjects();
+        return;
+    }
+
+    // Ensure destination folder exists
+    QDir().mkpath(mCurrentProjectPath);
+
+    // Refresh file contents
+    bool webViewRequired = false;
+    for (FileContent& file: parseFolderChange(pMessage))
+    {
+        webViewRequired = webViewRequired || importsWebView(file.content);
+
+        QString localFileName = file.file.remove(folderName);
+        localFileName = localFileName.startsWith("/") ? localFileName.remove(0,1) : localFileName;
+        qCDebug(lcSync) << "File:" << localFileName;
+
+        mFileWriter.add(mCurrentProjectPath + "/" + localFileName, file.content);
+    }
+    emit webViewRequired(webViewRequired);
+
+    cacheEntry.webView = webViewRequired;
+    mPendingCacheEntry = cacheEntry;
+}
+
+void SyncWorker::handleFileChangeMessage(const QString &pMessage)
+{
+    // Find the corresponding local file
+    QString currentFileName = messageContent(pMessage, "file");
+    if (currentFileName.isEmpty())
+        return;
+
+    QString currentFileContent = messageContent(pMessage, "content");
+
+    QString currentFilePathLocal = mCurrentProjectPath + "/" + relativeFilePathFromRemoteFilePath(currentFileName);
+
+    // Replace contents: the project no longer matches its last manifest
+    QByteArray content = currentFileContent.toUtf8();
+    mFileWriter.add(currentFilePathLocal, content);
+    invalidateCurrentManifest();
+    if (importsWebView(currentFileContent))
+        emit webViewRequired(true);
+
+    // The whole file is the base of the next patches
+    mResyncRequested.remove(currentFileName);
+    if (mPatchedFiles.contains(currentFilePathLocal))
+        setPatchedFile(currentFilePathLocal, content);
+
+    // Check for a current file change
+    handleCurrentFileChangeMessage(pMessage);
+}
+
+void SyncWorker::handleFilePatchMessage(const QString &pMessage)
+{
+    QString currentFileName = messageContent(pMessage, "file");
+    if (currentFileName.isEmpty())
+        return;
+
+    // Patches are dropped until the whole file is sent again
+    if (mResyncRequested.contains(currentFileName))
+        return;
+
+    QString currentFilePathLocal = mCurrentProjectPath + "/" + relativeFilePathFromRemoteFilePath(currentFileName);
+
+    // The base is the latest content of the file: patched in memory, waiting in the batch, or on disk
+    QByteArray content;
+    auto patched = mPatchedFiles.constFind(currentFilePathLocal);
+    if (patched != mPatchedFiles.constEnd())
+    {
+        content = *patched;
+    }
+    else if (!mFileWriter.pendingContent(currentFilePathLocal, content))
+    {
+        QFile file(currentFilePathLocal);
+        if (file.open(QIODevice::ReadOnly))
+            content = file.readAll();
+    }
+
+    QByteArray baseHash = QByteArray::fromHex(messageContent(pMessage, "basehash").toLatin1());
+    QVector<TextEdit> edits;
+    if (BatchFileWriter::contentHash(content) != baseHash || !parseEdits(pMessage, edits) || !applyEdits(content, edits))
+    {
+        qCDebug(lcSync) << "Cannot patch" << currentFileName << "- requesting the whole file";
+        removePatchedFile(currentFilePathLocal);
+        mResyncRequested.insert(currentFileName);
+        emit resyncRequired(currentFileName);
+        return;
+    }
+
+    setPatchedFile(currentFilePathLocal, content);
+    mFileWriter.add(currentFilePathLocal, content);
+    invalidateCurrentManifest();
+    if (content.contains("import QtWebView"))
+        emit webViewRequired(true);
+
+    handleCurrentFileChangeMessage(pMessage);
+}
+
+void SyncWorker::handleCurrentFileChangeMessage(const QString &pMessage)
+{
+    // Extract current file from message
+    QString currentFileDistant = messageContent(pMessage, "currentfile");
+    if (currentFileDistant.isEmpty())
+        return;
+
+    // TODO: fix urls such as C:\Users\user\folder\file:///C:\Users\user\folder\main.qml
+    mPendingCurrentFile = localFilePathFromRemoteFilePath(currentFileDistant);
+}
+
+void SyncWorker::invalidateCurrentManifest()
+{
+    if (mPendingCacheEntry.name == currentProjectName())
+        mPendingCacheEntry.manifestHash.clear();
+    else
+        mProjectCache.invalidate(currentProjectName());
+}
+
+void SyncWorker::setPatchedFile(const QString &pFilePath, const QByteArray &pContent)
+{
+    removePatchedFile(pFilePath);
+    mPatchedFiles.insert(pFilePath, pContent);
+    mPatchedBytes += pFilePath.size() * qint64(sizeof(QChar)) + pContent.size();
+}
+
+void SyncWorker::removePatchedFile(const QString &pFilePath)
+{
+    auto it = mPatchedFiles.find(pFilePath);
+    if (it == mPatchedFiles.end())
+        return;
+
+    mPatchedBytes -= pFilePath.size() * qint64(sizeof(QChar)) + it->size();
+    mPatchedFiles.erase(it);
+}
+
+void SyncWorker::clearPatchedFiles()
+{
+    mPatchedFiles.clear();
+    mPatchedBytes = 0;
+}
+
+QString SyncWorker::relativeFilePathFromRemoteFilePath(const QString &pRemoteFile)
+{
+    QString localFile = pRemoteFile;
+    localFile.remove(mCurrentFolder);
+    localFile.remove("file:///");
+    if (localFile.startsWith("/"))
+        localFile.remove(0,1);
+
+    return localFile;
+}
+
+QString SyncWorker::localFilePathFromRemoteFilePath(const QString &pRemoteFile)
+{
+    return "file:///" + mCurrentProjectPath + "/" + relativeFilePathFromRemoteFilePath(pRemoteFile);
+}
+
+QString SyncWorker::currentProjectName() const
+{
+    return mCurrentProjectPath.mid(mCurrentProjectPath.lastIndexOf("/") + 1);
+}
+
+void SyncWorker::finishBatch()
+{
+    // Served from memory: the document reloads while the files are written
+    bool servedFromMemory = false;
+    if (mMemoryStore)
+    {
+        QHash<QString, QByteArray> files = mFileWriter.pendingFiles();
+        for (auto it = files.constBegin(); it != files.constEnd(); ++it)
+            mMemoryStore->insert(it.key(), it.value());
+        servedFromMemory = true;
+        reportBatch();
+    }
+
+    FileWriteStats stats = mFileWriter.flush();
+    if (stats.written > 0 || stats.skipped > 0)
+    {
+        qCDebug(lcSync) << "Files written:" << stats.written
+                 << "skipped:" << stats.skipped
+                 << "bytes saved:" << stats.bytesSaved;
+
+        mWriteStats += stats;
+        emit writeStatsChanged(mWriteStats.written, mWriteStats.skipped, mWriteStats.bytesSaved);
+
+    }
+    mCacheBytes.store(mFileWriter.cacheBytes() + mPatchedBytes);
+
+    if (!mPendingCacheEntry.name.isEmpty())
+    {
+        mProjectCache.update(mPendingCacheEntry);
+        mPendingCacheEntry = ProjectCache::Entry();
+
+        if (!mProjectCache.evict(currentProjectName()).isEmpty())
+        {
+            // Entries of evicted files are stale, and so are the blobs only they used
+            mFileWriter.clearCache();
+            mCacheBytes.store(mPatchedBytes);
+            qCDebug(lcSync) << "Pruned" << mBlobStore.prune() << "bytes of blobs";
+        }
+        refreshCachedProjects();
+    }
+
+    if (!servedFromMemory)
+        reportBatch();
+}
+
+void SyncWorker::reportBatch()
+{
+    if (mProjectChanged)
+    {
+        mProjectChanged = false;
+        emit projectReady(mCurrentFolder, mCurrentProjectPath);
+    }
+
+    // Traces go on until the reload is displayed, if there is one
+    bool reloadExpected = !mPendingCurrentFile.isEmpty();
+    if (mLatencyTracer)
+    {
+        for (quint64 traceId: mBatchTraces)
+        {
+            mLatencyTracer->mark(traceId, LatencyTracer::Written);
+            if (!reloadExpected)
+                mLatencyTracer->finishTrace(traceId);
+        }
+    }
+    mBatchTraces.clear();
+
+    if (reloadExpected)
+    {
+        emit currentFileReady(mPendingCurrentFile);
+        mPendingCurrentFile.clear();
+    }
+}
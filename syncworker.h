@@ -0,0 +1,183 @@
+#ifndef SYNCWORKER_H
+#define SYNCWORKER_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+
+#include "assetimporter.h"
+#include "blobstore.h"
+#include "filewriter.h"
+#include "latencytracer.h"
+#include "memoryfilestore.h"
+#include "projectcache.h"
+
+// ---------------------------------------------------------------
+// SyncWorker
+// ---------------------------------------------------------------
+
+// Lives on the sync thread: parses server messages and writes the project files
+// in arrival order. Only the resulting project/current file events reach the GUI thread.
+class SyncWorker: public QObject
+{
+    Q_OBJECT
+
+public:
+    struct PendingMessage
+    {
+        bool isBinary = false;
+        QString text;
+        QByteArray data;
+        quint64 traceId = 0;
+    };
+
+    struct FileContent
+    {
+        QString file; // remote path
+        QString content;
+    };
+
+    explicit SyncWorker(QObject* parent = nullptr);
+
+    // Thread-safe, may be called from any thread
+    void postTextMessage(const QString& pMessage, quint64 pTraceId = 0);
+    void postBinaryMessage(const QByteArray& pMessage, quint64 pTraceId = 0);
+
+    // Must be called before the first message is posted
+    void setWritePath(const QString& pWritePath);
+    void setProjectsPath(const QString& pProjectsPath);
+    void setLatencyTracer(LatencyTracer* pLatencyTracer);
+
+    // Text files are also published there, before they are written
+    void setMemoryStore(MemoryFileStore* pMemoryStore);
+
+    // Disk budget of the project cache, in bytes (0 means unbounded)
+    void setProjectsBudget(qint64 pBytes);
+
+    // Project restored from the cache at launch, until the server sends a folderchange
+    void setCurrentProject(const QString& pFolder, const QString& pProjectPath);
+
+    // Memory accounting, thread-safe
+    qint64 pendingBytes() const;
+    qint64 importBytes() const;
+    qint64 cacheBytes() const;
+
+    // Thread-safe: nothing queued, nor being processed
+    bool isIdle() const;
+
+    // Thread-safe: drops queued text messages made obsolete by a later one. Returns the bytes freed.
+    qint64 dropSupersededMessages();
+
+    static QString messageContent(const QString& message,
+                                  const QString& tag,
+                                  int fromIndex = 0);
+    static bool createFile(QString pPath, QString pFileName, QString pFileContent);
+
+    // The files of a folderchange message, in message order
+    static QVector<FileContent> parseFolderChange(const QString& pMessage);
+
+    // Only selects a file: what remains of a superseded message that carried the last selection
+    static QString currentFileMessage(const QString& pRemoteFile);
+
+    // Asks the server for the whole content of a file, after a failed filepatch
+    static QString resyncMessage(const QString& pRemoteFile);
+
+    // Sent on connection: the asset formats this client reads, preferred first.
+    // Servers that do not know it keep sending zip files.
+    static QString capabilitiesMessage();
+
+signals:
+    void projectReady(QString folder, QString projectPath);
+    void currentFileReady(QString currentFile);
+    void jsonMessageReady(QString json);
+    void assetImportFinished(QString errorString);
+    void writeStatsChanged(int written, int skipped, qint64 bytesSaved);
+    void webViewRequired(bool required);
+    void cachedProjectsChanged(QVariantList projects);
+
+    // A filepatch could not be applied: the server must send the whole file again
+    void resyncRequired(QString remoteFile);
+
+public slots:
+    // Forgets the write-if-changed cache (files are then compared with the disk again)
+    void trimCaches();
+
+    // Switches to a cached project without a push from the server
+    void openCachedProject(const QString& pName);
+
+    // A file of this project was modified locally
+    void invalidateCachedProject(const QString& pPath);
+
+    // Reports the cached projects
+    void refreshCachedProjects();
+
+protected slots:
+    void processPendingMessages();
+
+protected:
+    void post(const PendingMessage& pMessage);
+    static qint64 messageBytes(const PendingMessage& pMessage);
+
+    void handleTextMessage(const QString& pMessage, quint64 pTraceId);
+    void handleBinaryMessage(const QByteArray& pMessage, quint64 pTraceId);
+    void handleFolderChangeMessage(const QString& pMessage);
+    void handleFileChangeMessage(const QString& pMessage);
+    void handleFilePatchMessage(const QString& pMessage);
+    void handleCurrentFileChangeMessage(const QString& pMessage);
+
+    // The project no longer matches the manifest of its last folderchange
+    void invalidateCurrentManifest();
+
+    // In-memory copies of the files edited through patches
+    void setPatchedFile(const QString& pFilePath, const QByteArray& pContent);
+    void removePatchedFile(const QString& pFilePath);
+    void clearPatchedFiles();
+
+    QString relativeFilePathFromRemoteFilePath(const QString& pRemoteFile);
+    QString localFilePathFromRemoteFilePath(const QString& pRemoteFile);
+    QString currentProjectName() const;
+
+    // Writes the coalesced files and reports the final project/current file
+    void finishBatch();
+    void reportBatch();
+
+private:
+    mutable QMutex mMutex;
+    QQueue<PendingMessage> mPendingMessages;
+    bool mProcessingScheduled = false;
+    qint64 mPendingBytes = 0;
+
+    QAtomicInteger<qint64> mImportBytes;
+    QAtomicInteger<qint64> mCacheBytes;
+
+    // Only accessed from the sync thread
+    QString mWritePath;
+    QString mProjectsPath;
+    QString mCurrentFolder;
+    QString mCurrentProjectPath;
+
+    bool mProjectChanged = false;
+    QString mPendingCurrentFile;
+
+    LatencyTracer* mLatencyTracer = nullptr;
+    MemoryFileStore* mMemoryStore = nullptr;
+    QVector<quint64> mBatchTraces;
+
+    AssetImporter mAssetImporter;
+    BlobStore mBlobStore;
+    BatchFileWriter mFileWriter;
+
+    // Files being edited through filepatch messages (local path -> UTF-8 content), the patch bases
+    QHash<QString, QByteArray> mPatchedFiles;
+    qint64 mPatchedBytes = 0;
+    QSet<QString> mResyncRequested;
+
+    // Recorded in the project cache once the batch is written
+    ProjectCache mProjectCache;
+    ProjectCache::Entry mPendingCacheEntry;
+    FileWriteStats mWriteStats;
+};
+
+#endif // SYNCWORKER_H
@@ -0,0 +1,42 @@
+# Benchmarks of the sync, import and file tree hot paths, built against the client sources:
+#   qmake tests/benchmarks && make && ./tst_benchmarks -o results.xml,xml
+QT += core qml network concurrent testlib
+
+# For ZipReader & ZipWriter
+QT += gui-private
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_benchmarks
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../assetbundle.cpp \
+    ../../assetimporter.cpp \
+    ../../blobstore.cpp \
+    ../../filesystem.cpp \
+    ../../filewriter.cpp \
+    ../../fstreesnapshot.cpp \
+    ../../latencytracer.cpp \
+    ../../logging.cpp \
+    ../../memoryfilestore.cpp \
+    ../../projectcache.cpp \
+    ../../syncworker.cpp \
+    tst_benchmarks.cpp
+
+HEADERS += \
+    ../../assetbundle.h \
+    ../../assetimporter.h \
+    ../../blobstore.h \
+    ../../filesystem.h \
+    ../../filewriter.h \
+    ../../fstreesnapshot.h \
+    ../../latencytracer.h \
+    ../../logging.h \
+    ../../memoryfilestore.h \
+    ../../projectcache.h \
+    ../../syncworker.h
@@ -0,0 +1,359 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QDataStream>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <private/qzipwriter_p.h>
+
+#include <cstring>
+
+#include "assetbundle.h"
+#include "assetimporter.h"
+#include "blobstore.h"
+#include "filesystem.h"
+#include "filewriter.h"
+#include "syncworker.h"
+
+namespace
+{
+const int kFilesPerDirectory = 100;
+}
+
+inline QString qmlFileContent(int pIndex)
+{
+    return QString("import QtQuick 2.9\n\n"
+                   "Rectangle {\n"
+                   "    id: item%1\n"
+                   "    width: %1 %% 640\n"
+                   "    height: 40\n"
+                   "    color: \"#%2\"\n"
+                   "    Text { anchors.centerIn: parent; text: \"File %1\" }\n"
+                   "}\n").arg(pIndex).arg(pIndex % 0xffffff, 6, 16, QChar('0'));
+}
+
+inline QString remoteFilePath(const QString& pRemoteFolder, int pIndex)
+{
+    return QString("%1/dir%2/File%3.qml").arg(pRemoteFolder).arg(pIndex / kFilesPerDirectory).arg(pIndex);
+}
+
+// Same format as the playground server
+inline QString folderChangeMessage(const QString& pRemoteFolder, int pFileCount)
+{
+    QString message = "<messagetype>folderchange</messagetype>";
+    message += "<folder>" + pRemoteFolder + "</folder>";
+    for (int i = 0; i < pFileCount; ++i)
+    {
+        message += "<file>" + remoteFilePath(pRemoteFolder, i) + "</file>";
+        message += "<content>" + qmlFileContent(i) + "</content>";
+    }
+    message += "<currentfile>" + remoteFilePath(pRemoteFolder, 0) + "</currentfile>";
+    return message;
+}
+
+// Random (incompressible) assets, or QML text, as a zip or an asset bundle
+inline QByteArray assetMessage(const QString& pProjectName, int pAssetCount, int pAssetSize, bool pText, bool pBundle)
+{
+    QBuffer zipBuffer;
+    zipBuffer.open(QIODevice::WriteOnly);
+    QZipWriter zipWriter(&zipBuffer);
+    AssetBundleWriter bundleWriter;
+
+    QByteArray asset(pAssetSize, Qt::Uninitialized);
+    for (int i = 0; i < pAssetCount; ++i)
+    {
+        if (pText)
+        {
+            QByteArray text = qmlFileContent(i).toUtf8();
+            for (int offset = 0; offset < pAssetSize; offset += text.size())
+                std::memcpy(asset.data() + offset, text.constData(), size_t(qMin(text.size(), pAssetSize - offset)));
+        }
+        else
+        {
+            QRandomGenerator::global()->fillRange(reinterpret_cast<quint32*>(asset.data()), pAssetSize / 4);
+        }
+
+        QString path = QString("assets/asset%1.%2").arg(i).arg(pText ? "qml" : "bin");
+        if (pBundle)
+            bundleWriter.addFile(path, asset);
+        else
+            zipWriter.addFile(path, asset);
+    }
+    zipWriter.close();
+
+    QByteArray payload = pBundle ? bundleWriter.data() : zipBuffer.data();
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << pProjectName
+           << qint32(payload.size())
+           << QString();
+    stream.writeRawData(payload.constData(), payload.size());
+    return message;
+}
+
+inline int countRows(QAbstractItemModel& pModel, const QModelIndex& pParent = QModelIndex())
+{
+    int rows = pModel.rowCount(pParent);
+    int count = rows;
+    for (int row = 0; row < rows; ++row)
+        count += countRows(pModel, pModel.index(row, 0, pParent));
+    return count;
+}
+
+// ---------------------------------------------------------------
+// BenchmarksTest
+// ---------------------------------------------------------------
+
+// The sync, import and file tree hot paths on synthetic projects of 10, 1k and 50k files.
+// Cold runs (first write, first extraction) are measured once; the others are repeated by QBENCHMARK.
+class BenchmarksTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void parse_data() { fileCounts(); }
+    void parse();
+    void folderChangeCold_data() { fileCounts(); }
+    void folderChangeCold();
+    void folderChangeUnchanged_data() { fileCounts(); }
+    void folderChangeUnchanged();
+
+    void treeLoadEntries_data() { fileCounts(); }
+    void treeLoadEntries();
+    void treeLoadEntriesSnapshot_data() { fileCounts(); }
+    void treeLoadEntriesSnapshot();
+    void treeFilter_data() { fileCounts(); }
+    void treeFilter();
+
+    void importZip_data() { assetSets(); }
+    void importZip();
+    void importUnchanged_data() { assetSets(); }
+    void importUnchanged();
+    void importBundle_data() { assetSets(); }
+    void importBundle();
+    void importBlobs_data() { assetSets(); }
+    void importBlobs();
+
+private:
+    void fileCounts();
+    void assetSets();
+
+    void processMessage(SyncWorker& pWorker, const QString& pMessage);
+    QString treePath(int pFileCount);
+    void importOnce(const QByteArray& pMessage, bool pCold);
+
+    QTemporaryDir mWorkDir;
+    QSet<int> mGeneratedTrees;
+    int mColdRuns = 0;
+};
+
+void BenchmarksTest::initTestCase()
+{
+    QVERIFY(mWorkDir.isValid());
+}
+
+void BenchmarksTest::fileCounts()
+{
+    QTest::addColumn<int>("fileCount");
+    for (int fileCount: { 10, 1000, 50000 })
+        QTest::newRow(qPrintable(QString::number(fileCount))) << fileCount;
+}
+
+void BenchmarksTest::assetSets()
+{
+    // Many small assets, a few large ones, and text
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("text");
+    QTest::newRow("small") << 1000 << 4 * 1024 << false;
+    QTest::newRow("large") << 8 << 8 * 1024 * 1024 << false;
+    QTest::newRow("text") << 1000 << 4 * 1024 << true;
+}
+
+void BenchmarksTest::processMessage(SyncWorker &pWorker, const QString &pMessage)
+{
+    pWorker.postTextMessage(pMessage);
+    QMetaObject::invokeMethod(&pWorker, "processPendingMessages", Qt::DirectConnection);
+}
+
+QString BenchmarksTest::treePath(int pFileCount)
+{
+    const QString path = mWorkDir.path() + "/tree" + QString::number(pFileCount);
+    if (!mGeneratedTrees.contains(pFileCount))
+    {
+        BatchFileWriter writer;
+        for (int i = 0; i < pFileCount; ++i)
+            writer.add(path + QString("/dir%1/File%2.qml").arg(i / kFilesPerDirectory).arg(i), qmlFileContent(i));
+        writer.flush();
+        mGeneratedTrees.insert(pFileCount);
+    }
+    return path;
+}
+
+void BenchmarksTest::parse()
+{
+    QFETCH(int, fileCount);
+    const QString message = folderChangeMessage("C:/remote/Bench" + QString::number(fileCount), fileCount);
+
+    QBENCHMARK
+    {
+        QCOMPARE(SyncWorker::parseFolderChange(message).size(), fileCount);
+    }
+}
+
+void BenchmarksTest::folderChangeCold()
+{
+    // Parse and write into a project that does not exist yet
+    QFETCH(int, fileCount);
+    const QString message = folderChangeMessage("C:/remote/Cold" + QString::number(mColdRuns++), fileCount);
+
+    SyncWorker worker;
+    worker.setWritePath(mWorkDir.path());
+    worker.setProjectsPath(mWorkDir.path() + "/projects/");
+    QBENCHMARK_ONCE
+    {
+        processMessage(worker, message);
+    }
+}
+
+void BenchmarksTest::folderChangeUnchanged()
+{
+    QFETCH(int, fileCount);
+    const QString message = folderChangeMessage("C:/remote/Bench" + QString::number(fileCount), fileCount);
+
+    SyncWorker worker;
+    worker.setWritePath(mWorkDir.path());
+    worker.setProjectsPath(mWorkDir.path() + "/projects/");
+    processMessage(worker, message);
+    QBENCHMARK
+    {
+        processMessage(worker, message);
+    }
+}
+
+void BenchmarksTest::treeLoadEntries()
+{
+    QFETCH(int, fileCount);
+    const QString path = treePath(fileCount);
+
+    FsEntryModel treeModel;
+    QBENCHMARK
+    {
+        treeModel.setPath(path);
+    }
+}
+
+void BenchmarksTest::treeLoadEntriesSnapshot()
+{
+    QFETCH(int, fileCount);
+    const QString path = treePath(fileCount);
+
+    // Directories just created are always listed again
+    QTest::qWait(2100);
+    FsEntryModel treeModel;
+    treeModel.setSnapshotPath(path + ".snapshot");
+    treeModel.setPath(path);
+    QBENCHMARK
+    {
+        treeModel.setPath(path);
+    }
+}
+
+void BenchmarksTest::treeFilter()
+{
+    QFETCH(int, fileCount);
+
+    FsProxyModel proxyModel;
+    proxyModel.setPath(treePath(fileCount));
+    int iteration = 0;
+    QBENCHMARK
+    {
+        proxyModel.setFilterText(iteration++ % 2 == 0 ? "file1 qml" : "file2");
+        countRows(proxyModel);
+    }
+}
+
+void BenchmarksTest::importOnce(const QByteArray &pMessage, bool pCold)
+{
+    AssetImporter importer;
+    importer.mWritePath = mWorkDir.path();
+    importer.messageToProcess = pMessage;
+
+    // Without the index of the previous run, every entry is extracted
+    if (pCold)
+    {
+        QFile::remove(importer.indexPath(QTest::currentDataTag()));
+        QBENCHMARK_ONCE
+        {
+            importer.run();
+        }
+        QCOMPARE(importer.stats.unchanged, 0);
+    }
+    else
+    {
+        importer.run();
+        QBENCHMARK
+        {
+            importer.run();
+        }
+        QCOMPARE(importer.stats.extracted, 0);
+    }
+    QVERIFY2(importer.errorString.isEmpty(), qPrintable(importer.errorString));
+    QCOMPARE(importer.stats.failed, 0);
+}
+
+void BenchmarksTest::importZip()
+{
+    QFETCH(int, count);
+    QFETCH(int, size);
+    QFETCH(bool, text);
+    importOnce(assetMessage(QTest::currentDataTag(), count, size, text, false), true);
+}
+
+void BenchmarksTest::importUnchanged()
+{
+    QFETCH(int, count);
+    QFETCH(int, size);
+    QFETCH(bool, text);
+    importOnce(assetMessage(QTest::currentDataTag(), count, size, text, false), false);
+}
+
+void BenchmarksTest::importBundle()
+{
+    // Stored or LZ4 entries, decoded in parallel
+    QFETCH(int, count);
+    QFETCH(int, size);
+    QFETCH(bool, text);
+    importOnce(assetMessage(QTest::currentDataTag(), count, size, text, true), true);
+}
+
+void BenchmarksTest::importBlobs()
+{
+    // Every blob is already there after a first import
+    QFETCH(int, count);
+    QFETCH(int, size);
+    QFETCH(bool, text);
+    const QByteArray message = assetMessage(QTest::currentDataTag(), count, size, text, false);
+
+    BlobStore blobStore;
+    blobStore.setPath(mWorkDir.path() + "/blobs");
+    AssetImporter importer;
+    importer.mWritePath = mWorkDir.path();
+    importer.blobStore = &blobStore;
+    importer.messageToProcess = message;
+    importer.run();
+
+    QFile::remove(importer.indexPath(QTest::currentDataTag()));
+    QBENCHMARK_ONCE
+    {
+        importer.run();
+    }
+    QVERIFY2(importer.errorString.isEmpty(), qPrintable(importer.errorString));
+    QCOMPARE(importer.stats.failed, 0);
+}
+
+QTEST_GUILESS_MAIN(BenchmarksTest)
+
+#include "tst_benchmarks.moc"
@@ -0,0 +1,58 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QTimer>
+
+#include "standinserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("QmlPlaygroundStandInServer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless stand-in for the QmlPlayground server, for load-testing the client.");
+    parser.addHelpOption();
+
+    StandInServer::Settings settings;
+    QCommandLineOption idOption("id", "Server id shown by the clients.", "id", settings.id);
+    QCommandLineOption projectOption("project", "Name of the pushed project.", "name", settings.projectName);
+    QCommandLineOption filesOption("files", "Number of text files in the project.", "count", QString::number(settings.fileCount));
+    QCommandLineOption fileSizeOption("file-size", "Size of each text file, in bytes.", "bytes", QString::number(settings.fileSize));
+    QCommandLineOption assetsOption("assets", "Number of binary assets (0 sends a plain folderchange).", "count", QString::number(settings.assetCount));
+    QCommandLineOption assetSizeOption("asset-size", "Size of each asset, in bytes.", "bytes", QString::number(settings.assetSize));
+    QCommandLineOption assetFormatOption("asset-format", "Asset bundle format: auto (as announced by the client), zip or bundle.", "format", settings.assetFormat);
+    QCommandLineOption editRateOption("edit-rate", "filechange messages per second (0 to disable).", "rate", QString::number(settings.editRate));
+    QCommandLineOption patchesOption("patches", "Send edits as filepatch messages instead of whole files.");
+    QCommandLineOption dataRateOption("data-rate", "data messages per second (0 to disable).", "rate", QString::number(settings.dataRate));
+    QCommandLineOption durationOption("duration", "Quit after this many seconds (0 runs forever).", "seconds", "0");
+    parser.addOptions({ idOption, projectOption, filesOption, fileSizeOption, assetsOption,
+                        assetSizeOption, assetFormatOption, editRateOption, patchesOption, dataRateOption, durationOption });
+    parser.process(app);
+
+    settings.id = parser.value(idOption);
+    settings.projectName = parser.value(projectOption);
+    settings.fileCount = parser.value(filesOption).toInt();
+    settings.fileSize = parser.value(fileSizeOption).toInt();
+    settings.assetCount = parser.value(assetsOption).toInt();
+    settings.assetSize = parser.value(assetSizeOption).toInt();
+    settings.assetFormat = parser.value(assetFormatOption);
+    if (!QStringList({ "auto", "zip", "bundle" }).contains(settings.assetFormat))
+    {
+        qCritical() << "Unknown asset format" << settings.assetFormat;
+        return 1;
+    }
+    settings.editRate = parser.value(editRateOption).toDouble();
+    settings.patches = parser.isSet(patchesOption);
+    settings.dataRate = parser.value(dataRateOption).toDouble();
+
+    StandInServer server(settings);
+    if (!server.start())
+        return 1;
+
+    int duration = parser.value(durationOption).toInt();
+    if (duration > 0)
+        QTimer::singleShot(duration * 1000, &app, &QCoreApplication::quit);
+
+    return app.exec();
+}
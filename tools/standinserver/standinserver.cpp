@@ -0,0 +1,286 @@
+#include "standinserver.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QRandomGenerator>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <private/qzipwriter_p.h>
+
+#include "assetbundle.h"
+
+namespace
+{
+const quint16 kDiscoveryPort = 45454;
+const int kAnnounceInterval = 1000; // ms
+const int kCapabilitiesTimeout = 500; // ms, before sending a zip to a client that announced nothing
+}
+
+// ---------------------------------------------------------------
+// StandInServer
+// ---------------------------------------------------------------
+
+StandInServer::StandInServer(const Settings &pSettings, QObject *parent)
+    : QObject(parent),
+      mSettings(pSettings),
+      mGroupAddress4(QStringLiteral("239.255.255.250")),
+      mGroupAddress6(QStringLiteral("ff12::2115"))
+{
+    mRevisions.fill(0, mSettings.fileCount);
+
+    mServer = new QWebSocketServer(mSettings.id, QWebSocketServer::NonSecureMode, this);
+    connect(mServer, &QWebSocketServer::newConnection, this, &StandInServer::onNewConnection);
+
+    mAnnounceTimer.setInterval(kAnnounceInterval);
+    connect(&mAnnounceTimer, &QTimer::timeout, this, &StandInServer::announce);
+
+    if (mSettings.editRate > 0.0)
+        mEditTimer.setInterval(qMax(1, int(1000.0 / mSettings.editRate)));
+    connect(&mEditTimer, &QTimer::timeout, this, &StandInServer::sendEdit);
+
+    if (mSettings.dataRate > 0.0)
+        mDataTimer.setInterval(qMax(1, int(1000.0 / mSettings.dataRate)));
+    connect(&mDataTimer, &QTimer::timeout, this, &StandInServer::sendData);
+}
+
+bool StandInServer::start()
+{
+    if (!mServer->listen(QHostAddress::Any, mSettings.port))
+    {
+        qCritical() << "Could not listen on port" << mSettings.port << ":" << mServer->errorString();
+        return false;
+    }
+
+    mUdpSocket4.bind(QHostAddress(QHostAddress::AnyIPv4), 0);
+    mUdpSocket4.setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+    if (!mUdpSocket6.bind(QHostAddress(QHostAddress::AnyIPv6), 0))
+        qDebug() << "Announcing on IPv4 only";
+    else
+        mUdpSocket6.setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+
+    announce();
+    mAnnounceTimer.start();
+
+    qInfo() << "Stand-in server" << mSettings.id << "listening on port" << mSettings.port
+            << "-" << mSettings.fileCount << "files," << mSettings.assetCount << "assets,"
+            << mSettings.editRate << (mSettings.patches ? "patches/s," : "edits/s,") << mSettings.dataRate << "data messages/s";
+    return true;
+}
+
+void StandInServer::announce()
+{
+    // Same datagram as the playground server
+    QByteArray datagram = "qmlplayground<id>" + mSettings.id.toUtf8() + "</id>";
+    mUdpSocket4.writeDatagram(datagram, mGroupAddress4, kDiscoveryPort);
+    if (mUdpSocket6.state() == QAbstractSocket::BoundState)
+        mUdpSocket6.writeDatagram(datagram, mGroupAddress6, kDiscoveryPort);
+}
+
+void StandInServer::onNewConnection()
+{
+    while (mServer->hasPendingConnections())
+    {
+        QWebSocket* client = mServer->nextPendingConnection();
+        qInfo() << "Client connected:" << client->peerAddress().toString();
+
+        connect(client, &QWebSocket::disconnected, this, [=]()
+        {
+            qInfo() << "Client disconnected:" << client->peerAddress().toString();
+            mClients.removeAll(client);
+            client->deleteLater();
+
+            if (mClients.isEmpty())
+            {
+                mEditTimer.stop();
+                mDataTimer.stop();
+            }
+        });
+        connect(client, &QWebSocket::textMessageReceived, this, [=](const QString& pMessage)
+        {
+            handleTextMessage(client, pMessage);
+        });
+
+        // Clients announce the asset formats they read on connection, older ones do not
+        if (mSettings.assetCount > 0 && mSettings.assetFormat == "auto")
+        {
+            QTimer::singleShot(kCapabilitiesTimeout, client, [=]()
+            {
+                if (!mClients.contains(client))
+                    sendProject(client, false);
+            });
+        }
+        else
+        {
+            sendProject(client, mSettings.assetFormat == "bundle");
+        }
+    }
+
+    if (mSettings.editRate > 0.0 && !mEditTimer.isActive())
+        mEditTimer.start();
+    if (mSettings.dataRate > 0.0 && !mDataTimer.isActive())
+        mDataTimer.start();
+}
+
+void StandInServer::sendProject(QWebSocket *pClient, bool pBundle)
+{
+    // Edits only go to clients that have the project
+    mClients.append(pClient);
+
+    // Assets embed the folderchange, like the playground server does
+    if (mSettings.assetCount > 0)
+        pClient->sendBinaryMessage(assetMessage(pBundle));
+    else
+        pClient->sendTextMessage(folderChangeMessage());
+}
+
+void StandInServer::sendEdit()
+{
+    if (mSettings.fileCount <= 0)
+        return;
+
+    int index = mEditCount++ % mSettings.fileCount;
+    ++mRevisions[index];
+
+    QString message = mSettings.patches ? filePatchMessage(index) : fileChangeMessage(index);
+    for (QWebSocket* client: mClients)
+        client->sendTextMessage(message);
+}
+
+void StandInServer::handleTextMessage(QWebSocket *pClient, const QString &pMessage)
+{
+    // <messagetype>capabilities</messagetype><assetformats>qpb1,zip</assetformats>: the project can be sent
+    if (pMessage.startsWith("<messagetype>capabilities</messagetype>"))
+    {
+        QStringList formats = pMessage.section("<assetformats>", 1).section("</assetformats>", 0, 0).split(',');
+        if (!mClients.contains(pClient))
+            sendProject(pClient, formats.contains(AssetBundle::kFormatName));
+        return;
+    }
+
+    // <messagetype>resync</messagetype><file>...</file>: a patch did not apply, send the whole file
+    if (!pMessage.startsWith("<messagetype>resync</messagetype>"))
+        return;
+
+    QString file = pMessage.section("<file>", 1).section("</file>", 0, 0);
+    for (int i = 0; i < mSettings.fileCount; ++i)
+    {
+        if (remoteFilePath(i) == file)
+        {
+            qInfo() << "Resync of" << file << "requested by" << pClient->peerAddress().toString();
+            pClient->sendTextMessage(fileChangeMessage(i));
+            return;
+        }
+    }
+}
+
+void StandInServer::sendData()
+{
+    QString message = QString("<messagetype>data</messagetype><json>{\"standInCounter\": %1}</json>").arg(mDataCount++);
+
+    for (QWebSocket* client: mClients)
+        client->sendTextMessage(message);
+}
+
+QString StandInServer::remoteFilePath(int pIndex) const
+{
+    return QString("/standin/%1/File%2.qml").arg(mSettings.projectName).arg(pIndex);
+}
+
+QString StandInServer::fileContent(int pIndex, int pRevision) const
+{
+    QString content = QString("import QtQuick 2.9\n\n"
+                              "Rectangle {\n"
+                              "    anchors.fill: parent\n"
+                              "    color: Qt.hsla(%1, 0.5, 0.5, 1.0)\n"
+                              "    Text { anchors.centerIn: parent; text: \"File %2 - revision %3\" }\n"
+                              "}\n")
+                      .arg((pIndex * 37 + pRevision * 11) % 100 / 100.0)
+                      .arg(pIndex)
+                      .arg(pRevision);
+
+    // Pad with a comment up to the requested size
+    int padding = mSettings.fileSize - content.size() - 6;
+    if (padding > 0)
+        content += "/* " + QString(padding, QChar('x')) + " */\n";
+    return content;
+}
+
+QString StandInServer::fileChangeMessage(int pIndex) const
+{
+    QString message = "<messagetype>filechange</messagetype>";
+    message += "<file>" + remoteFilePath(pIndex) + "</file>";
+    message += "<content>" + fileContent(pIndex, mRevisions.at(pIndex)) + "</content>";
+    message += "<currentfile>" + remoteFilePath(pIndex) + "</currentfile>";
+    return message;
+}
+
+QString StandInServer::filePatchMessage(int pIndex) const
+{
+    // Clients hold the previous revision: one edit replaces what lies between the common prefix and suffix.
+    // Contents are ASCII, so the boundaries never split a UTF-8 sequence.
+    QByteArray base = fileContent(pIndex, mRevisions.at(pIndex) - 1).toUtf8();
+    QByteArray content = fileContent(pIndex, mRevisions.at(pIndex)).toUtf8();
+
+    int prefix = 0;
+    int maxLength = qMin(base.size(), content.size());
+    while (prefix < maxLength && base.at(prefix) == content.at(prefix))
+        prefix++;
+    int suffix = 0;
+    while (suffix < maxLength - prefix && base.at(base.size() - 1 - suffix) == content.at(content.size() - 1 - suffix))
+        suffix++;
+
+    QString message = "<messagetype>filepatch</messagetype>";
+    message += "<file>" + remoteFilePath(pIndex) + "</file>";
+    message += "<basehash>" + QCryptographicHash::hash(base, QCryptographicHash::Sha1).toHex() + "</basehash>";
+    message += QString("<edit>%1,%2</edit>").arg(prefix).arg(base.size() - prefix - suffix);
+    message += "<text>" + QString::fromUtf8(content.mid(prefix, content.size() - prefix - suffix)) + "</text>";
+    message += "<currentfile>" + remoteFilePath(pIndex) + "</currentfile>";
+    return message;
+}
+
+QString StandInServer::folderChangeMessage() const
+{
+    QString message = "<messagetype>folderchange</messagetype>";
+    message += "<folder>/standin/" + mSettings.projectName + "</folder>";
+    for (int i = 0; i < mSettings.fileCount; ++i)
+    {
+        message += "<file>" + remoteFilePath(i) + "</file>";
+        message += "<content>" + fileContent(i, mRevisions.at(i)) + "</content>";
+    }
+    if (mSettings.fileCount > 0)
+        message += "<currentfile>" + remoteFilePath(0) + "</currentfile>";
+    return message;
+}
+
+QByteArray StandInServer::assetMessage(bool pBundle) const
+{
+    QBuffer zipBuffer;
+    zipBuffer.open(QIODevice::WriteOnly);
+    QZipWriter zipWriter(&zipBuffer);
+    AssetBundleWriter bundleWriter;
+
+    QRandomGenerator generator(42); // the same bundle for every client
+    QByteArray asset(mSettings.assetSize, Qt::Uninitialized);
+    for (int i = 0; i < mSettings.assetCount; ++i)
+    {
+        generator.fillRange(reinterpret_cast<quint32*>(asset.data()), asset.size() / 4);
+        QString path = QString("assets/asset%1.bin").arg(i);
+        if (pBundle)
+            bundleWriter.addFile(path, asset);
+        else
+            zipWriter.addFile(path, asset);
+    }
+    zipWriter.close();
+
+    QByteArray payload = pBundle ? bundleWriter.data() : zipBuffer.data();
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << mSettings.projectName
+           << qint32(payload.size())
+           << folderChangeMessage();
+    stream.writeRawData(payload.constData(), payload.size());
+    return message;
+}
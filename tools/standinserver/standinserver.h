@@ -0,0 +1,82 @@
+#ifndef STANDINSERVER_H
+#define STANDINSERVER_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QList>
+#include <QTimer>
+#include <QUdpSocket>
+
+QT_BEGIN_NAMESPACE
+class QWebSocket;
+class QWebSocketServer;
+QT_END_NAMESPACE
+
+// ---------------------------------------------------------------
+// StandInServer
+// ---------------------------------------------------------------
+
+// Headless stand-in for the desktop playground: announces itself like the real server
+// and pushes a synthetic project, edits and data messages to every connected client.
+class StandInServer: public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        QString id = "standin";
+        QString projectName = "StandInProject";
+        quint16 port = 12345;    // the client always connects to this port
+
+        int fileCount = 20;
+        int fileSize = 2048;     // bytes per text file
+        int assetCount = 0;
+        int assetSize = 64 * 1024;
+        QString assetFormat = "auto"; // auto (the best the client announces), zip or bundle
+
+        double editRate = 1.0;   // filechange messages per second
+        bool patches = false;    // edits sent as filepatch messages
+        double dataRate = 0.0;   // data messages per second
+    };
+
+    explicit StandInServer(const Settings& pSettings, QObject* parent = nullptr);
+
+    bool start();
+
+protected:
+    void announce();
+    void onNewConnection();
+    void sendProject(QWebSocket* pClient, bool pBundle);
+    void sendEdit();
+    void handleTextMessage(QWebSocket* pClient, const QString& pMessage);
+    void sendData();
+
+    QString remoteFilePath(int pIndex) const;
+    QString fileContent(int pIndex, int pRevision) const;
+    QString fileChangeMessage(int pIndex) const;
+    QString filePatchMessage(int pIndex) const;
+    QString folderChangeMessage() const;
+    QByteArray assetMessage(bool pBundle) const;
+
+private:
+    Settings mSettings;
+
+    QWebSocketServer* mServer = nullptr;
+    QList<QWebSocket*> mClients;
+
+    QUdpSocket mUdpSocket4;
+    QUdpSocket mUdpSocket6;
+    QHostAddress mGroupAddress4;
+    QHostAddress mGroupAddress6;
+
+    QTimer mAnnounceTimer;
+    QTimer mEditTimer;
+    QTimer mDataTimer;
+
+    QVector<int> mRevisions;
+    int mEditCount = 0;
+    int mDataCount = 0;
+};
+
+#endif // STANDINSERVER_H
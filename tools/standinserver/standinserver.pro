@@ -0,0 +1,21 @@
+QT += core network websockets
+
+# For ZipWriter
+QT += gui-private
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# The asset bundle format is shared with the client
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../assetbundle.cpp \
+    main.cpp \
+    standinserver.cpp
+
+HEADERS += \
+    ../../assetbundle.h \
+    standinserver.h